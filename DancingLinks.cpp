@@ -0,0 +1,237 @@
+#include "DancingLinks.h"
+#include "SudokuGeometry.h"
+
+template <int N>
+DancingLinks<N>::DancingLinks()
+{
+	nodes = 0;
+	trace = NULL;
+	// root and column headers form the horizontal header list
+	for (int c = 0; c <= COLS; c++)
+	{
+		left[c] = (c == 0) ? COLS : c - 1;
+		right[c] = (c == COLS) ? 0 : c + 1;
+		up[c] = down[c] = column[c] = c;
+		rowOf[c] = -1;
+		size[c] = 0;
+	}
+
+	int node = COLS + 1;
+	for (int row = 0; row < ROWS; row++)
+	{
+		int cell = row / SIZE, digit = row % SIZE;
+		int r = SudokuGeometry<N>::rowOf(cell), c = SudokuGeometry<N>::colOf(cell), b = SudokuGeometry<N>::boxOf(cell);
+		int cols[4] = {
+			1 + cell,							// each cell holds one digit
+			1 + CELLS + r * SIZE + digit,		// each row holds each digit
+			1 + 2 * CELLS + c * SIZE + digit,	// each col holds each digit
+			1 + 3 * CELLS + b * SIZE + digit	// each block holds each digit
+		};
+
+		firstNode[row] = node;
+		for (int n = 0; n < 4; n++, node++)
+		{
+			int h = cols[n];
+			column[node] = h;
+			rowOf[node] = row;
+			// append to the bottom of the column
+			up[node] = up[h];
+			down[node] = h;
+			down[up[h]] = node;
+			up[h] = node;
+			size[h]++;
+			// circular list across the row
+			left[node] = (n == 0) ? node + 3 : node - 1;
+			right[node] = (n == 3) ? node - 3 : node + 1;
+		}
+	}
+}
+
+// removes column c from the header list and its rows from every other column
+template <int N>
+void DancingLinks<N>::cover(int c)
+{
+	right[left[c]] = right[c];
+	left[right[c]] = left[c];
+	for (int i = down[c]; i != c; i = down[i])
+	{
+		for (int j = right[i]; j != i; j = right[j])
+		{
+			down[up[j]] = down[j];
+			up[down[j]] = up[j];
+			size[column[j]]--;
+		}
+	}
+}
+
+// exact reverse of cover(c)
+template <int N>
+void DancingLinks<N>::uncover(int c)
+{
+	for (int i = up[c]; i != c; i = up[i])
+	{
+		for (int j = left[i]; j != i; j = left[j])
+		{
+			size[column[j]]++;
+			down[up[j]] = j;
+			up[down[j]] = j;
+		}
+	}
+	right[left[c]] = c;
+	left[right[c]] = c;
+}
+
+// covers every column of a matrix row, as if the search had picked it
+template <int N>
+void DancingLinks<N>::select(int row)
+{
+	int first = firstNode[row];
+	cover(column[first]);
+	for (int j = right[first]; j != first; j = right[j])
+	{
+		cover(column[j]);
+	}
+}
+
+template <int N>
+void DancingLinks<N>::deselect(int row)
+{
+	int first = firstNode[row];
+	for (int j = left[first]; j != first; j = left[j])
+	{
+		uncover(column[j]);
+	}
+	uncover(column[first]);
+}
+
+template <int N>
+bool DancingLinks<N>::isCovered(int c) const
+{
+	return right[left[c]] != c;
+}
+
+template <int N>
+bool DancingLinks<N>::search(int k)
+{
+	nodes++;
+	SUDOKU_STAT(if (k > stats.maxDepth) stats.maxDepth = k);
+	if (right[0] == 0)
+	{
+		for (int n = 0; n < k; n++)
+		{
+			result[chosen[n] / SIZE] = chosen[n] % SIZE + 1;
+		}
+		return true;
+	}
+
+	// branch on the column with the fewest rows left
+	int c = right[0];
+	for (int j = right[c]; j != 0; j = right[j])
+	{
+		if (size[j] < size[c])
+		{
+			c = j;
+		}
+	}
+	if (size[c] == 0)
+	{
+		return false;
+	}
+
+	bool found = false;
+	cover(c);
+	for (int r = down[c]; r != c && !found; r = down[r])
+	{
+		chosen[k] = rowOf[r];
+		SUDOKU_STAT(if (trace != NULL) trace->branch(k + 1, rowOf[r] / SIZE, rowOf[r] % SIZE + 1));
+		for (int j = right[r]; j != r; j = right[j])
+		{
+			cover(column[j]);
+		}
+		found = search(k + 1);
+		SUDOKU_STAT(if (!found) { stats.backtracks++; if (trace != NULL) trace->undo(k + 1); });
+		for (int j = left[r]; j != r; j = left[j])
+		{
+			uncover(column[j]);
+		}
+	}
+	uncover(c);
+	return found;
+}
+
+template <int N>
+long DancingLinks<N>::nodeCount() const
+{
+	return nodes;
+}
+
+// counters of the last solve(), all zero unless built with SUDOKU_STATS
+template <int N>
+const SudokuStats &DancingLinks<N>::statistics() const
+{
+	return stats;
+}
+
+// records the rows picked by every following solve() to t, NULL to stop
+template <int N>
+void DancingLinks<N>::setTrace(SudokuTrace *t)
+{
+	trace = t;
+}
+
+template <int N>
+bool DancingLinks<N>::solve(unsigned char *grid)
+{
+	int givens[CELLS];
+	int count = 0;
+	bool ok = true;
+
+	// take the givens out of the matrix first, stopping at the first clash
+	for (int cell = 0; cell < CELLS && ok; cell++)
+	{
+		int k = grid[cell];
+		if (k < 1 || k > SIZE)
+		{
+			continue;
+		}
+		int row = cell * SIZE + k - 1;
+		int first = firstNode[row];
+		if (isCovered(column[first]))
+		{
+			ok = false;
+			break;
+		}
+		for (int j = right[first]; j != first; j = right[j])
+		{
+			if (isCovered(column[j]))
+			{
+				ok = false;
+			}
+		}
+		if (ok)
+		{
+			select(row);
+			givens[count++] = row;
+		}
+	}
+
+	nodes = 0;
+	SUDOKU_STAT(stats.reset());
+	if (ok)
+	{
+		result = grid;
+		ok = search(0);
+	}
+
+	// put the matrix back the way the constructor left it
+	while (count > 0)
+	{
+		deselect(givens[--count]);
+	}
+	return ok;
+}
+
+template class DancingLinks<2>;
+template class DancingLinks<3>;
+template class DancingLinks<4>;
+template class DancingLinks<5>;
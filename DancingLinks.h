@@ -0,0 +1,58 @@
+// Exact cover solver for Sudoku using Knuth's Dancing Links (Algorithm X), for a
+// board with N x N boxes (N = 3 is the usual 9x9).
+//
+// The matrix has 4 * CELLS columns (cell, row/digit, col/digit, block/digit) and
+// CELLS * SIZE rows (one per cell/digit pair), 324 x 729 for 9x9. All nodes live in
+// fixed arrays inside the object and are linked once in the constructor; every
+// solve() leaves the links exactly as it found them, so one object can be reused
+// for any number of puzzles. The object is large (about 80KB for 9x9, 1.5MB for
+// 25x25), so allocate it on the heap rather than the stack.
+
+#ifndef __DANCING_LINKS_
+#define __DANCING_LINKS_
+
+#include "SudokuStats.h"
+
+template <int N>
+class DancingLinks
+{
+private:
+	static constexpr int SIZE = N * N;
+	static constexpr int CELLS = SIZE * SIZE;
+	static constexpr int COLS = 4 * CELLS;
+	static constexpr int ROWS = CELLS * SIZE;
+	static constexpr int NODES = 1 + COLS + ROWS * 4;	// root, column headers, then 4 nodes per row
+
+	int left[NODES];
+	int right[NODES];
+	int up[NODES];
+	int down[NODES];
+	int column[NODES];		// column header of each node
+	int rowOf[NODES];		// matrix row of each node, (cell * SIZE) + digit - 1
+	int size[COLS + 1];		// nodes left in each column
+	int firstNode[ROWS];	// first of the 4 nodes of each matrix row
+
+	int chosen[CELLS];		// matrix rows picked by the search
+	unsigned char *result;	// grid the solution is written to, row-major
+	long nodes;				// search nodes entered by the last solve()
+	SudokuStats stats;		// only updated when built with SUDOKU_STATS
+	SudokuTrace *trace;
+
+	void cover(int c);
+	void uncover(int c);
+	void select(int row);
+	void deselect(int row);
+	bool isCovered(int c) const;
+	bool search(int k);
+
+public:
+	DancingLinks();
+	// fills the empty (0) cells of the row-major grid with a solution. returns false,
+	// leaving grid untouched, if the givens conflict or the puzzle has no solution
+	bool solve(unsigned char *grid);
+	long nodeCount() const;
+	const SudokuStats &statistics() const;
+	void setTrace(SudokuTrace *t);
+};
+
+#endif /* __DANCING_LINKS_ */
@@ -0,0 +1,76 @@
+#include <cstring>
+#include <errno.h>
+#include <unistd.h>
+#include "GridWriter.h"
+
+const size_t MIN_CAPACITY = 1 << 16;
+
+GridWriter::GridWriter(int fd, size_t capacity)
+	: buffer(capacity > MIN_CAPACITY ? capacity : MIN_CAPACITY)
+{
+	this->fd = fd;
+	used = 0;
+	failed = false;
+}
+
+GridWriter::~GridWriter()
+{
+	flush();
+}
+
+// makes room for bytes more, by flushing if they do not fit
+void GridWriter::reserve(size_t bytes)
+{
+	if (buffer.size() - used < bytes)
+	{
+		flush();
+	}
+}
+
+void GridWriter::write(const char *data, size_t length)
+{
+	if (length > buffer.size() - used)
+	{
+		flush();
+		if (length > buffer.size())
+		{
+			// as big as a block, no point copying it
+			while (length > 0 && !failed)
+			{
+				ssize_t sent = ::write(fd, data, length);
+				if (sent < 0 && errno != EINTR)
+				{
+					failed = true;
+				}
+				else if (sent > 0)
+				{
+					data += sent;
+					length -= sent;
+				}
+			}
+			return;
+		}
+	}
+	memcpy(&buffer[used], data, length);
+	used += length;
+}
+
+bool GridWriter::flush()
+{
+	size_t done = 0;
+	while (done < used && !failed)
+	{
+		ssize_t sent = ::write(fd, &buffer[done], used - done);
+		if (sent < 0 && errno != EINTR)
+		{
+			failed = true;
+		}
+		else if (sent > 0)
+		{
+			done += sent;
+		}
+	}
+	// after a failure the rest is dropped, later writes still have room
+	used = 0;
+	return !failed;
+}
@@ -0,0 +1,47 @@
+// Buffered output of rendered grids.
+//
+// Grids are rendered with BasicSudoku::format() straight into a large buffer,
+// which goes to the file descriptor in one write() when it fills up, so a batch
+// job makes one system call per block instead of per line or per cell. Nothing
+// is flushed at line ends; call flush() before the output is needed elsewhere.
+
+#ifndef __GRID_WRITER_
+#define __GRID_WRITER_
+
+#include <cstddef>
+#include <vector>
+#include "Sudoku.h"
+
+class GridWriter
+{
+public:
+	// writes to fd, opened by the caller and left open. capacity is the block
+	// size and at least 64 KB
+	explicit GridWriter(int fd, size_t capacity = 1 << 20);
+	// flushes, errors are lost
+	~GridWriter();
+
+	template <int N>
+	void write(const BasicSudoku<N> &grid, SudokuBase::Format format)
+	{
+		reserve(BasicSudoku<N>::FORMAT_BYTES);
+		used += grid.format(&buffer[used], format);
+	}
+	void write(const char *data, size_t length);
+
+	// writes out the buffer. false if this or any earlier write failed
+	bool flush();
+
+private:
+	std::vector<char> buffer;
+	size_t used;
+	int fd;
+	bool failed;
+
+	void reserve(size_t bytes);
+
+	GridWriter(const GridWriter &);
+	GridWriter &operator=(const GridWriter &);
+};
+
+#endif /* __GRID_WRITER_ */
@@ -0,0 +1,570 @@
+#include <cstring>
+#include "LogicSolver.h"
+
+const unsigned short ALL_DIGITS = 0x1FF;
+
+static const char *NAMES[LogicSolver::TECHNIQUES] = {
+	"none", "naked single", "hidden single", "pointing", "box/line reduction",
+	"naked pair", "x-wing", "hidden pair", "naked triple", "swordfish",
+	"hidden triple", "xy-wing", "naked quad", "jellyfish", "hidden quad", "search"
+};
+
+static const int SCORES[LogicSolver::TECHNIQUES] = {
+	0, 10, 12, 17, 19, 30, 32, 34, 36, 38, 40, 42, 50, 52, 54, 100
+};
+
+typedef SudokuGeometry<3> Geometry;
+
+static inline bool sees(int a, int b)
+{
+	return Geometry::rowOf(a) == Geometry::rowOf(b) || Geometry::colOf(a) == Geometry::colOf(b) ||
+		Geometry::boxOf(a) == Geometry::boxOf(b);
+}
+
+const char *LogicSolver::name(Technique t)
+{
+	return NAMES[t];
+}
+
+int LogicSolver::score(Technique t)
+{
+	return SCORES[t];
+}
+
+LogicSolver::Rating LogicSolver::apply(Sudoku &puzzle)
+{
+	Rating r = run(puzzle);
+	if (r.contradiction)
+	{
+		// the digits placed conflict, the puzzle stays as it was given
+		return r;
+	}
+	char givens[Sudoku::CELLS + 1], line[Sudoku::CELLS];
+	puzzle.format(givens, Sudoku::LINE);
+	for (int cell = 0; cell < 81; cell++)
+	{
+		line[cell] = '0' + digit[cell];
+	}
+	if (!puzzle.loadFromLine(line, Sudoku::CELLS))
+	{
+		puzzle.loadFromLine(givens, Sudoku::CELLS);
+		r.solved = false;
+		r.contradiction = true;
+	}
+	return r;
+}
+
+LogicSolver::Rating LogicSolver::rate(const Sudoku &puzzle)
+{
+	return run(puzzle);
+}
+
+bool LogicSolver::solve(Sudoku &puzzle, Rating *rating)
+{
+	Rating r = apply(puzzle);
+	if (rating != NULL)
+	{
+		*rating = r;
+	}
+	if (r.solved || r.contradiction)
+	{
+		return r.solved;
+	}
+	return puzzle.solveWithin(Sudoku::Budget()) == Sudoku::SOLVED;
+}
+
+// tries the techniques cheapest first, going back to the cheapest after each one
+// that made progress
+LogicSolver::Rating LogicSolver::run(const Sudoku &puzzle)
+{
+	Rating r;
+	memset(&r, 0, sizeof(r));
+	load(puzzle);
+	while (empty > 0 && check())
+	{
+		Technique used = NONE;
+		for (int t = NAKED_SINGLE; t < SEARCH && used == NONE; t++)
+		{
+			if (useTechnique((Technique)t))
+			{
+				used = (Technique)t;
+			}
+		}
+		if (used == NONE)
+		{
+			break;
+		}
+		r.uses[used]++;
+		r.steps++;
+		if (used > r.hardest)
+		{
+			r.hardest = used;
+		}
+	}
+	r.contradiction = broken;
+	r.solved = empty == 0 && !broken;
+	if (!r.solved)
+	{
+		r.hardest = SEARCH;
+	}
+	r.score = SCORES[r.hardest];
+	return r;
+}
+
+void LogicSolver::load(const Sudoku &puzzle)
+{
+	char line[Sudoku::CELLS];
+	puzzle.toLine(line);
+	for (int cell = 0; cell < 81; cell++)
+	{
+		digit[cell] = 0;
+		cand[cell] = ALL_DIGITS;
+	}
+	empty = 81;
+	broken = false;
+	for (int cell = 0; cell < 81; cell++)
+	{
+		if (line[cell] != '0')
+		{
+			place(cell, line[cell] - '0');
+		}
+	}
+}
+
+// puts k in cell and takes it out of the candidates of the peers. a given that
+// repeats a peer's digit breaks the puzzle
+void LogicSolver::place(int cell, int k)
+{
+	unsigned short bit = 1 << (k - 1);
+	if ((cand[cell] & bit) == 0)
+	{
+		broken = true;
+	}
+	digit[cell] = k;
+	cand[cell] = 0;
+	empty--;
+	const Geometry::Cell *peers = Geometry::peers(cell);
+	for (int n = 0; n < Geometry::PEERS; n++)
+	{
+		cand[peers[n]] &= ~bit;
+	}
+}
+
+// true if cell had any of bits
+bool LogicSolver::eliminate(int cell, unsigned short bits)
+{
+	if ((cand[cell] & bits) == 0)
+	{
+		return false;
+	}
+	cand[cell] &= ~bits;
+	return true;
+}
+
+// false once an empty cell has no candidates or a unit has nowhere for a digit
+bool LogicSolver::check()
+{
+	for (int cell = 0; cell < 81 && !broken; cell++)
+	{
+		broken = digit[cell] == 0 && cand[cell] == 0;
+	}
+	for (int u = 0; u < 27 && !broken; u++)
+	{
+		unsigned short covered = 0;
+		for (int n = 0; n < 9; n++)
+		{
+			int cell = Geometry::unit(u)[n];
+			covered |= digit[cell] != 0 ? 1 << (digit[cell] - 1) : cand[cell];
+		}
+		broken = covered != ALL_DIGITS;
+	}
+	return !broken;
+}
+
+bool LogicSolver::useTechnique(Technique t)
+{
+	switch (t)
+	{
+	case NAKED_SINGLE:
+		return nakedSingles();
+	case HIDDEN_SINGLE:
+		return hiddenSingles();
+	case POINTING:
+		return pointing();
+	case BOX_LINE:
+		return boxLine();
+	case NAKED_PAIR:
+		return nakedSubsets(2);
+	case X_WING:
+		return fish(2);
+	case HIDDEN_PAIR:
+		return hiddenSubsets(2);
+	case NAKED_TRIPLE:
+		return nakedSubsets(3);
+	case SWORDFISH:
+		return fish(3);
+	case HIDDEN_TRIPLE:
+		return hiddenSubsets(3);
+	case XY_WING:
+		return xyWing();
+	case NAKED_QUAD:
+		return nakedSubsets(4);
+	case JELLYFISH:
+		return fish(4);
+	case HIDDEN_QUAD:
+		return hiddenSubsets(4);
+	default:
+		return false;
+	}
+}
+
+// every cell with one candidate left gets it
+bool LogicSolver::nakedSingles()
+{
+	bool progress = false;
+	for (int cell = 0; cell < 81; cell++)
+	{
+		unsigned short c = cand[cell];
+		if (c != 0 && (c & (c - 1)) == 0)
+		{
+			place(cell, __builtin_ctz(c) + 1);
+			progress = true;
+		}
+	}
+	return progress;
+}
+
+// every digit with one cell left in a unit goes there
+bool LogicSolver::hiddenSingles()
+{
+	bool progress = false;
+	for (int u = 0; u < 27; u++)
+	{
+		const Geometry::Cell *cells = Geometry::unit(u);
+		unsigned short once = 0, twice = 0;
+		for (int n = 0; n < 9; n++)
+		{
+			twice |= once & cand[cells[n]];
+			once |= cand[cells[n]];
+		}
+		unsigned short hidden = once & ~twice;
+		for (int n = 0; n < 9 && hidden != 0; n++)
+		{
+			// a cell holding two hidden digits keeps the first, check() finds the other
+			unsigned short bit = cand[cells[n]] & hidden;
+			if (bit != 0)
+			{
+				bit &= -bit;
+				place(cells[n], __builtin_ctz(bit) + 1);
+				hidden &= ~bit;
+				progress = true;
+			}
+		}
+	}
+	return progress;
+}
+
+// a digit whose candidates in a box all lie on one row or col is not anywhere
+// else on that line
+bool LogicSolver::pointing()
+{
+	bool progress = false;
+	for (int b = 0; b < 9; b++)
+	{
+		const Geometry::Cell *cells = Geometry::unit(18 + b);
+		for (int k = 0; k < 9; k++)
+		{
+			unsigned short bit = 1 << k;
+			int rows = 0, cols = 0;
+			for (int n = 0; n < 9; n++)
+			{
+				if (cand[cells[n]] & bit)
+				{
+					rows |= 1 << Geometry::rowOf(cells[n]);
+					cols |= 1 << Geometry::colOf(cells[n]);
+				}
+			}
+			if (rows != 0 && (rows & (rows - 1)) == 0)
+			{
+				int i = __builtin_ctz(rows);
+				for (int j = 0; j < 9; j++)
+				{
+					if (Geometry::boxOf(i * 9 + j) != b)
+					{
+						progress |= eliminate(i * 9 + j, bit);
+					}
+				}
+			}
+			if (cols != 0 && (cols & (cols - 1)) == 0)
+			{
+				int j = __builtin_ctz(cols);
+				for (int i = 0; i < 9; i++)
+				{
+					if (Geometry::boxOf(i * 9 + j) != b)
+					{
+						progress |= eliminate(i * 9 + j, bit);
+					}
+				}
+			}
+		}
+	}
+	return progress;
+}
+
+// a digit whose candidates on a row or col all lie in one box is not anywhere
+// else in that box
+bool LogicSolver::boxLine()
+{
+	bool progress = false;
+	for (int u = 0; u < 18; u++)
+	{
+		const Geometry::Cell *cells = Geometry::unit(u);
+		for (int k = 0; k < 9; k++)
+		{
+			unsigned short bit = 1 << k;
+			int boxes = 0;
+			for (int n = 0; n < 9; n++)
+			{
+				if (cand[cells[n]] & bit)
+				{
+					boxes |= 1 << Geometry::boxOf(cells[n]);
+				}
+			}
+			if (boxes == 0 || (boxes & (boxes - 1)) != 0)
+			{
+				continue;
+			}
+			const Geometry::Cell *box = Geometry::unit(18 + __builtin_ctz(boxes));
+			for (int n = 0; n < 9; n++)
+			{
+				bool onLine = u < 9 ? Geometry::rowOf(box[n]) == u : Geometry::colOf(box[n]) == u - 9;
+				if (!onLine)
+				{
+					progress |= eliminate(box[n], bit);
+				}
+			}
+		}
+	}
+	return progress;
+}
+
+// size cells of a unit with only size candidates between them take those digits,
+// so the other cells of the unit lose them
+bool LogicSolver::nakedSubsets(int size)
+{
+	bool progress = false;
+	for (int u = 0; u < 27; u++)
+	{
+		const Geometry::Cell *cells = Geometry::unit(u);
+		int open = 0;
+		for (int n = 0; n < 9; n++)
+		{
+			if (cand[cells[n]] != 0)
+			{
+				open |= 1 << n;
+			}
+		}
+		if (__builtin_popcount(open) <= size)
+		{
+			continue;
+		}
+		// every choice of size open cells, as a bit mask over the unit
+		for (int chosen = 0; chosen < 512; chosen++)
+		{
+			if ((chosen & ~open) != 0 || __builtin_popcount(chosen) != size)
+			{
+				continue;
+			}
+			unsigned short digits = 0;
+			for (int n = 0; n < 9; n++)
+			{
+				if (chosen & (1 << n))
+				{
+					digits |= cand[cells[n]];
+				}
+			}
+			if (__builtin_popcount(digits) != size)
+			{
+				continue;
+			}
+			for (int n = 0; n < 9; n++)
+			{
+				if ((open & ~chosen) & (1 << n))
+				{
+					progress |= eliminate(cells[n], digits);
+				}
+			}
+		}
+	}
+	return progress;
+}
+
+// size digits with only size cells of a unit between them take those cells, so
+// the cells lose every other candidate
+bool LogicSolver::hiddenSubsets(int size)
+{
+	bool progress = false;
+	for (int u = 0; u < 27; u++)
+	{
+		const Geometry::Cell *cells = Geometry::unit(u);
+		int where[9] = { 0 };		// cells of the unit, as a mask, each digit can go
+		int open = 0;				// digits not placed in the unit
+		for (int n = 0; n < 9; n++)
+		{
+			for (int k = 0; k < 9; k++)
+			{
+				if (cand[cells[n]] & (1 << k))
+				{
+					where[k] |= 1 << n;
+					open |= 1 << k;
+				}
+			}
+		}
+		if (__builtin_popcount(open) <= size)
+		{
+			continue;
+		}
+		for (int digits = 0; digits < 512; digits++)
+		{
+			if ((digits & ~open) != 0 || __builtin_popcount(digits) != size)
+			{
+				continue;
+			}
+			int spots = 0;
+			for (int k = 0; k < 9; k++)
+			{
+				if (digits & (1 << k))
+				{
+					spots |= where[k];
+				}
+			}
+			if (__builtin_popcount(spots) != size)
+			{
+				continue;
+			}
+			for (int n = 0; n < 9; n++)
+			{
+				if (spots & (1 << n))
+				{
+					progress |= eliminate(cells[n], ~digits & ALL_DIGITS);
+				}
+			}
+		}
+	}
+	return progress;
+}
+
+// X-wing (size 2), swordfish (3) and jellyfish (4): if a digit's candidates on
+// size rows lie in only size cols, one of those rows holds it in each col, and
+// the other rows of those cols lose it. the same with rows and cols swapped
+bool LogicSolver::fish(int size)
+{
+	bool progress = false;
+	for (int k = 0; k < 9; k++)
+	{
+		unsigned short bit = 1 << k;
+		for (int byCols = 0; byCols < 2; byCols++)
+		{
+			// where[l] is the mask of cross lines where base line l has the digit
+			int where[9] = { 0 };
+			int eligible = 0;
+			for (int l = 0; l < 9; l++)
+			{
+				const Geometry::Cell *line = Geometry::unit(byCols ? 9 + l : l);
+				for (int x = 0; x < 9; x++)
+				{
+					if (cand[line[x]] & bit)
+					{
+						where[l] |= 1 << x;
+					}
+				}
+				int count = __builtin_popcount(where[l]);
+				if (count >= 2 && count <= size)
+				{
+					eligible |= 1 << l;
+				}
+			}
+			if (__builtin_popcount(eligible) < size)
+			{
+				continue;
+			}
+			for (int lines = 0; lines < 512; lines++)
+			{
+				if ((lines & ~eligible) != 0 || __builtin_popcount(lines) != size)
+				{
+					continue;
+				}
+				int cover = 0;
+				for (int l = 0; l < 9; l++)
+				{
+					if (lines & (1 << l))
+					{
+						cover |= where[l];
+					}
+				}
+				if (__builtin_popcount(cover) != size)
+				{
+					continue;
+				}
+				for (int l = 0; l < 9; l++)
+				{
+					if ((lines & (1 << l)) || (where[l] & cover) == 0)
+					{
+						continue;
+					}
+					for (int x = 0; x < 9; x++)
+					{
+						if (cover & (1 << x))
+						{
+							progress |= eliminate(Geometry::unit(byCols ? 9 + l : l)[x], bit);
+						}
+					}
+				}
+			}
+		}
+	}
+	return progress;
+}
+
+// a pivot with candidates xy sees one cell with xz and one with yz. whichever
+// digit the pivot takes, one of them is z, so no cell seeing both can be z
+bool LogicSolver::xyWing()
+{
+	bool progress = false;
+	for (int pivot = 0; pivot < 81; pivot++)
+	{
+		unsigned short xy = cand[pivot];
+		if (__builtin_popcount(xy) != 2)
+		{
+			continue;
+		}
+		for (int a = 0; a < Geometry::PEERS; a++)
+		{
+			int first = Geometry::peers(pivot)[a];
+			unsigned short xz = cand[first];
+			if (__builtin_popcount(xz) != 2 || __builtin_popcount(xz & xy) != 1)
+			{
+				continue;
+			}
+			unsigned short z = xz & ~xy;
+			unsigned short yz = z | (xy & ~xz);
+			for (int b = 0; b < Geometry::PEERS; b++)
+			{
+				int second = Geometry::peers(pivot)[b];
+				if (cand[second] != yz)
+				{
+					continue;
+				}
+				for (int n = 0; n < Geometry::PEERS; n++)
+				{
+					int cell = Geometry::peers(first)[n];
+					if (cell != second && sees(cell, second))
+					{
+						progress |= eliminate(cell, z);
+					}
+				}
+			}
+		}
+	}
+	return progress;
+}
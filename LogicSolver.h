@@ -0,0 +1,89 @@
+// Human-style solving of 9x9 puzzles, and a difficulty rating from it.
+//
+// The solver keeps a candidate set for every cell and applies the techniques a
+// person would, cheapest first: after any progress it starts again from singles,
+// so a harder technique is only used when nothing easier applies. The puzzle is
+// rated by the hardest technique it needed, on the familiar scale where singles
+// score around 1.0, intersections 1.7, pairs and X-wings 3.0 to 3.4 and quads and
+// jellyfish above 5.0 (scores are kept in tenths). A puzzle the techniques cannot
+// finish needs SEARCH and scores 10.0.
+//
+// Deterministic and cheap compared to a search, so ratings do not depend on the
+// machine or its load. Not thread safe; use one solver per thread.
+
+#ifndef __LOGIC_SOLVER_
+#define __LOGIC_SOLVER_
+
+#include "Sudoku.h"
+
+class LogicSolver
+{
+public:
+	// in the order they are tried, which is also the order of difficulty
+	enum Technique
+	{
+		NONE,
+		NAKED_SINGLE,
+		HIDDEN_SINGLE,
+		POINTING,			// a box's candidates for a digit on one line clear the line
+		BOX_LINE,			// a line's candidates for a digit in one box clear the box
+		NAKED_PAIR,
+		X_WING,
+		HIDDEN_PAIR,
+		NAKED_TRIPLE,
+		SWORDFISH,
+		HIDDEN_TRIPLE,
+		XY_WING,
+		NAKED_QUAD,
+		JELLYFISH,
+		HIDDEN_QUAD,
+		SEARCH,				// the techniques got stuck, only a search goes on
+		TECHNIQUES
+	};
+
+	struct Rating
+	{
+		bool solved;		// by the techniques alone
+		bool contradiction;	// the puzzle has no solution
+		Technique hardest;
+		int score;			// of the hardest technique, in tenths
+		int steps;			// techniques applied, a sweep of singles counts once
+		int uses[TECHNIQUES];
+	};
+
+	// applies the techniques to puzzle until it is solved or they get stuck, and
+	// leaves the digits they placed in it. a puzzle found to have no solution is
+	// left unchanged
+	Rating apply(Sudoku &puzzle);
+	// the rating of apply(), without changing the puzzle
+	Rating rate(const Sudoku &puzzle);
+	// apply(), then the most-constrained search from where the techniques stopped.
+	// rating may be NULL
+	bool solve(Sudoku &puzzle, Rating *rating = NULL);
+
+	static const char *name(Technique t);
+	static int score(Technique t);
+
+private:
+	unsigned char digit[81];		// 0 for an empty cell
+	unsigned short cand[81];		// bit k-1 set while k is possible, 0 once filled
+	int empty;						// cells left
+	bool broken;					// some cell or unit cannot be completed
+
+	Rating run(const Sudoku &puzzle);
+	void load(const Sudoku &puzzle);
+	void place(int cell, int k);
+	bool eliminate(int cell, unsigned short bits);
+	bool check();
+	bool useTechnique(Technique t);
+	bool nakedSingles();
+	bool hiddenSingles();
+	bool pointing();
+	bool boxLine();
+	bool nakedSubsets(int size);
+	bool hiddenSubsets(int size);
+	bool fish(int size);
+	bool xyWing();
+};
+
+#endif /* __LOGIC_SOLVER_ */
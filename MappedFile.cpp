@@ -0,0 +1,63 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const char *filename)
+{
+	bytes = NULL;
+	length = 0;
+	opened = false;
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		return;
+	}
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+	{
+		length = info.st_size;
+		if (length == 0)
+		{
+			opened = true;		// nothing to map, but not an error
+		}
+		else
+		{
+			void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED)
+			{
+				// corpora are read front to back
+				madvise(map, length, MADV_SEQUENTIAL);
+				bytes = (const char *)map;
+				opened = true;
+			}
+		}
+	}
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (bytes != NULL)
+	{
+		munmap((void *)bytes, length);
+	}
+}
+
+bool MappedFile::isOpen() const
+{
+	return opened;
+}
+
+const char *MappedFile::data() const
+{
+	return bytes;
+}
+
+size_t MappedFile::size() const
+{
+	return opened ? length : 0;
+}
@@ -0,0 +1,31 @@
+// Read-only memory mapping of a whole file.
+//
+// The bytes are paged in by the kernel as they are touched, so a large corpus can
+// be parsed straight from the mapping without copying it through a stream.
+
+#ifndef __MAPPED_FILE_
+#define __MAPPED_FILE_
+
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	explicit MappedFile(const char *filename);
+	~MappedFile();
+
+	// false if the file could not be opened or mapped
+	bool isOpen() const;
+	const char *data() const;
+	size_t size() const;
+
+private:
+	const char *bytes;
+	size_t length;
+	bool opened;
+
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+};
+
+#endif /* __MAPPED_FILE_ */
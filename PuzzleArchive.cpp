@@ -0,0 +1,283 @@
+#include <cstring>
+#include "PuzzleArchive.h"
+
+const int HEADER_SIZE = 32;
+const int INDEX_ENTRY_SIZE = 16;
+const uint16_t ARCHIVE_VERSION = 1;
+
+// lookup table for crc32Update, filled on first use
+struct Crc32Table
+{
+	uint32_t entry[256];
+
+	Crc32Table()
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			entry[n] = c;
+		}
+	}
+};
+
+// CRC-32 (IEEE 802.3, as used by zip), continued from crc
+static uint32_t crc32Update(uint32_t crc, const unsigned char *data, size_t length)
+{
+	static const Crc32Table table;
+
+	crc = ~crc;
+	for (size_t n = 0; n < length; n++)
+	{
+		crc = table.entry[(crc ^ data[n]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64(const unsigned char *p)
+{
+	return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+static void put32(unsigned char *p, uint32_t value)
+{
+	for (int n = 0; n < 4; n++)
+	{
+		p[n] = (value >> (8 * n)) & 0xFF;
+	}
+}
+
+static void put64(unsigned char *p, uint64_t value)
+{
+	put32(p, (uint32_t)value);
+	put32(p + 4, (uint32_t)(value >> 32));
+}
+
+PuzzleArchive::PuzzleArchive(const char *filename)
+	: file(filename)
+{
+	base = index = NULL;
+	count = 0;
+	perBlock = blocks = 0;
+	recordSize = 0;
+	solutions = false;
+	valid = false;
+
+	if (!file.isOpen() || file.size() < (size_t)HEADER_SIZE)
+	{
+		return;
+	}
+	base = (const unsigned char *)file.data();
+	if (memcmp(base, "SDKA", 4) != 0 || (base[4] | (base[5] << 8)) != ARCHIVE_VERSION || base[6] != Sudoku::SIZE)
+	{
+		return;
+	}
+	solutions = (base[7] & 1) != 0;
+	count = get64(base + 8);
+	perBlock = get32(base + 16);
+	blocks = get32(base + 20);
+	uint64_t indexOffset = get64(base + 24);
+	recordSize = Sudoku::PACKED_BYTES * (solutions ? 2 : 1);
+
+	// the index has to fit in the file and agree with the record count
+	if (perBlock == 0 || blocks != (count + perBlock - 1) / perBlock ||
+		indexOffset > file.size() || (file.size() - indexOffset) / INDEX_ENTRY_SIZE < blocks)
+	{
+		return;
+	}
+	index = base + indexOffset;
+	for (uint32_t b = 0; b < blocks; b++)
+	{
+		const unsigned char *entry = index + (size_t)b * INDEX_ENTRY_SIZE;
+		uint64_t offset = get64(entry);
+		uint32_t records = get32(entry + 8);
+		if (records > perBlock || offset > indexOffset || (indexOffset - offset) / recordSize < records)
+		{
+			return;
+		}
+	}
+	valid = true;
+}
+
+bool PuzzleArchive::isOpen() const
+{
+	return valid;
+}
+
+uint64_t PuzzleArchive::size() const
+{
+	return valid ? count : 0;
+}
+
+bool PuzzleArchive::hasSolutions() const
+{
+	return solutions;
+}
+
+uint32_t PuzzleArchive::blockCount() const
+{
+	return valid ? blocks : 0;
+}
+
+uint32_t PuzzleArchive::recordsPerBlock() const
+{
+	return valid ? perBlock : 0;
+}
+
+bool PuzzleArchive::load(uint64_t n, Sudoku &puzzle, Sudoku *solution) const
+{
+	if (!valid || n >= count || (solution != NULL && !solutions))
+	{
+		return false;
+	}
+	const unsigned char *entry = index + (size_t)(n / perBlock) * INDEX_ENTRY_SIZE;
+	if (n % perBlock >= get32(entry + 8))
+	{
+		return false;
+	}
+	const unsigned char *record = base + get64(entry) + (n % perBlock) * recordSize;
+	bool ok = puzzle.loadFromPacked(record);
+	if (solution != NULL)
+	{
+		ok = solution->loadFromPacked(record + Sudoku::PACKED_BYTES) && ok;
+	}
+	return ok;
+}
+
+bool PuzzleArchive::verifyBlock(uint32_t block) const
+{
+	if (!valid || block >= blocks)
+	{
+		return false;
+	}
+	const unsigned char *entry = index + (size_t)block * INDEX_ENTRY_SIZE;
+	uint32_t crc = crc32Update(0, base + get64(entry), (size_t)get32(entry + 8) * recordSize);
+	return crc == get32(entry + 12);
+}
+
+bool PuzzleArchive::verify() const
+{
+	if (!valid)
+	{
+		return false;
+	}
+	for (uint32_t b = 0; b < blocks; b++)
+	{
+		if (!verifyBlock(b))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+PuzzleArchiveWriter::PuzzleArchiveWriter(const char *filename, bool withSolutions, uint32_t recordsPerBlock)
+{
+	solutions = withSolutions;
+	perBlock = recordsPerBlock > 0 ? recordsPerBlock : 1;
+	count = 0;
+	offset = HEADER_SIZE;
+	failed = false;
+
+	// the header is rewritten by close() once the counts are known
+	unsigned char header[HEADER_SIZE] = { 0 };
+	file = fopen(filename, "wb");
+	if (file != NULL && fwrite(header, 1, HEADER_SIZE, file) != (size_t)HEADER_SIZE)
+	{
+		failed = true;
+	}
+}
+
+PuzzleArchiveWriter::~PuzzleArchiveWriter()
+{
+	close();
+}
+
+bool PuzzleArchiveWriter::isOpen() const
+{
+	return file != NULL;
+}
+
+bool PuzzleArchiveWriter::add(const Sudoku &puzzle, const Sudoku *solution)
+{
+	if (file == NULL)
+	{
+		return false;
+	}
+	unsigned char record[2 * Sudoku::PACKED_BYTES];
+	int size = Sudoku::PACKED_BYTES;
+	puzzle.toPacked(record);
+	if (solutions)
+	{
+		if (solution != NULL)
+			solution->toPacked(record + Sudoku::PACKED_BYTES);
+		else
+			memset(record + Sudoku::PACKED_BYTES, 0, Sudoku::PACKED_BYTES);
+		size += Sudoku::PACKED_BYTES;
+	}
+
+	if (count % perBlock == 0)
+	{
+		Block block = { offset, 0, 0 };
+		index.push_back(block);
+	}
+	Block &block = index.back();
+	block.crc = crc32Update(block.crc, record, size);
+	block.records++;
+
+	if (fwrite(record, 1, size, file) != (size_t)size)
+	{
+		failed = true;
+	}
+	offset += size;
+	count++;
+	return !failed;
+}
+
+bool PuzzleArchiveWriter::close()
+{
+	if (file == NULL)
+	{
+		return !failed;
+	}
+
+	for (size_t b = 0; b < index.size(); b++)
+	{
+		unsigned char entry[INDEX_ENTRY_SIZE];
+		put64(entry, index[b].offset);
+		put32(entry + 8, index[b].records);
+		put32(entry + 12, index[b].crc);
+		if (fwrite(entry, 1, INDEX_ENTRY_SIZE, file) != (size_t)INDEX_ENTRY_SIZE)
+		{
+			failed = true;
+		}
+	}
+
+	unsigned char header[HEADER_SIZE] = { 'S', 'D', 'K', 'A' };
+	header[4] = ARCHIVE_VERSION & 0xFF;
+	header[5] = ARCHIVE_VERSION >> 8;
+	header[6] = Sudoku::SIZE;
+	header[7] = solutions ? 1 : 0;
+	put64(header + 8, count);
+	put32(header + 16, perBlock);
+	put32(header + 20, (uint32_t)index.size());
+	put64(header + 24, offset);
+	if (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, HEADER_SIZE, file) != (size_t)HEADER_SIZE)
+	{
+		failed = true;
+	}
+	if (fclose(file) != 0)
+	{
+		failed = true;
+	}
+	file = NULL;
+	return !failed;
+}
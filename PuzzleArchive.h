@@ -0,0 +1,93 @@
+// Binary archive of 9x9 puzzles and, optionally, their solutions.
+//
+// Layout, all integers little-endian:
+//   header   32 bytes: "SDKA", u16 version (1), u8 board size (9), u8 flags
+//            (1 = has solutions), u64 record count, u32 records per block,
+//            u32 block count, u64 offset of the index
+//   records  fixed size: the givens packed two cells per byte (41 bytes, see
+//            Sudoku::toPacked), then the packed solution if the archive has
+//            solutions. An all-zero solution means the puzzle has none
+//   index    16 bytes per block: u64 offset of its first record, u32 number of
+//            records, u32 CRC-32 of the block's record bytes
+//
+// Puzzle n is at index[n / perBlock].offset + (n % perBlock) * recordSize, so a
+// reader fetches any record in O(1) straight from the mapped file, and a block can
+// be verified or copied to another shard on its own.
+
+#ifndef __PUZZLE_ARCHIVE_
+#define __PUZZLE_ARCHIVE_
+
+#include <cstdio>
+#include <stdint.h>
+#include <vector>
+#include "MappedFile.h"
+#include "Sudoku.h"
+
+class PuzzleArchive
+{
+public:
+	explicit PuzzleArchive(const char *filename);
+
+	// false if the file is missing or its header or index are damaged
+	bool isOpen() const;
+	uint64_t size() const;
+	bool hasSolutions() const;
+	uint32_t blockCount() const;
+	// puzzle n is in block n / recordsPerBlock()
+	uint32_t recordsPerBlock() const;
+
+	// loads puzzle n, and its solution if solution is not NULL. returns false if n
+	// is out of range, or a solution is asked for and the archive has none
+	bool load(uint64_t n, Sudoku &puzzle, Sudoku *solution = NULL) const;
+
+	// compares the stored CRC-32 of one block, or of all of them, with the data
+	bool verifyBlock(uint32_t block) const;
+	bool verify() const;
+
+private:
+	MappedFile file;
+	const unsigned char *base;
+	const unsigned char *index;
+	uint64_t count;
+	uint32_t perBlock;
+	uint32_t blocks;
+	int recordSize;
+	bool solutions;
+	bool valid;
+};
+
+class PuzzleArchiveWriter
+{
+public:
+	PuzzleArchiveWriter(const char *filename, bool withSolutions, uint32_t recordsPerBlock = 4096);
+	// calls close()
+	~PuzzleArchiveWriter();
+
+	bool isOpen() const;
+	// appends a record. solution is ignored for an archive without solutions and
+	// may be NULL (stored as no solution) for one with them
+	bool add(const Sudoku &puzzle, const Sudoku *solution = NULL);
+	// writes the index and the final header. returns false if any write failed
+	bool close();
+
+private:
+	struct Block
+	{
+		uint64_t offset;
+		uint32_t records;
+		uint32_t crc;
+	};
+
+	FILE *file;
+	bool solutions;
+	uint32_t perBlock;
+	uint64_t count;
+	uint64_t offset;		// where the next record goes
+	std::vector<Block> index;
+	bool failed;
+
+	PuzzleArchiveWriter(const PuzzleArchiveWriter &);
+	PuzzleArchiveWriter &operator=(const PuzzleArchiveWriter &);
+};
+
+#endif /* __PUZZLE_ARCHIVE_ */
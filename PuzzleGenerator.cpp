@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstring>
+#include "PuzzleGenerator.h"
+#include "LogicSolver.h"
+
+PuzzleGenerator::PuzzleGenerator(unsigned long long seed)
+	: rng(seed)
+{
+	targetClues = 0;
+	difficulty = ANY;
+	maxAttempts = 100;
+	solver.setSearchMode(Sudoku::MOST_CONSTRAINED);
+}
+
+void PuzzleGenerator::seed(unsigned long long seed)
+{
+	rng.seed(seed);
+}
+
+void PuzzleGenerator::setTargetClues(int clues)
+{
+	targetClues = clues;
+}
+
+void PuzzleGenerator::setDifficulty(Difficulty d)
+{
+	difficulty = d;
+}
+
+void PuzzleGenerator::setMaxAttempts(int attempts)
+{
+	maxAttempts = attempts > 0 ? attempts : 1;
+}
+
+PuzzleGenerator::Difficulty PuzzleGenerator::rate(const Sudoku &puzzle)
+{
+	LogicSolver techniques;
+	int score = techniques.rate(puzzle).score;
+	if (score <= LogicSolver::score(LogicSolver::HIDDEN_SINGLE))
+	{
+		return EASY;
+	}
+	return score <= LogicSolver::score(LogicSolver::HIDDEN_TRIPLE) ? MEDIUM : HARD;
+}
+
+// a random solved grid
+void PuzzleGenerator::fullGrid(char *grid)
+{
+	for (;;)
+	{
+		memset(grid, '0', Sudoku::CELLS);
+		for (int box = 0; box < 3; box++)
+		{
+			char digits[] = "123456789";
+			std::shuffle(digits, digits + 9, rng);
+			for (int k = 0; k < 9; k++)
+			{
+				grid[(box * 3 + k / 3) * 9 + box * 3 + k % 3] = digits[k];
+			}
+		}
+		// always completes, the loop is only a guard
+		if (solver.loadFromLine(grid, Sudoku::CELLS) && solver.solve())
+		{
+			solver.toLine(grid);
+			return;
+		}
+	}
+}
+
+// takes clues out of a full grid while the solution stays unique, returns the
+// number left
+int PuzzleGenerator::removeClues(char *grid)
+{
+	int order[Sudoku::CELLS];
+	for (int cell = 0; cell < Sudoku::CELLS; cell++)
+	{
+		order[cell] = cell;
+	}
+	std::shuffle(order, order + Sudoku::CELLS, rng);
+
+	int clues = Sudoku::CELLS;
+	for (int n = 0; n < Sudoku::CELLS && clues > targetClues; n++)
+	{
+		char digit = grid[order[n]];
+		grid[order[n]] = '0';
+		solver.loadFromLine(grid, Sudoku::CELLS);
+		if (solver.countSolutions(2) == 1)
+		{
+			clues--;
+		}
+		else
+		{
+			grid[order[n]] = digit;
+		}
+	}
+	return clues;
+}
+
+bool PuzzleGenerator::generate(char *puzzle, char *solution)
+{
+	char full[Sudoku::CELLS];
+	for (int attempt = 0; attempt < maxAttempts; attempt++)
+	{
+		fullGrid(full);
+		memcpy(puzzle, full, Sudoku::CELLS);
+		int clues = removeClues(puzzle);
+		if (targetClues > 0 && clues > targetClues)
+		{
+			continue;
+		}
+		if (difficulty != ANY)
+		{
+			solver.loadFromLine(puzzle, Sudoku::CELLS);
+			if (rate(solver) != difficulty)
+			{
+				continue;
+			}
+		}
+		if (solution != NULL)
+		{
+			memcpy(solution, full, Sudoku::CELLS);
+		}
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,54 @@
+// Random 9x9 puzzles with exactly one solution.
+//
+// A full grid is made by filling the three diagonal boxes (which never constrain
+// each other) with random permutations and letting the solver complete it. Clues
+// are then taken out in random order, each removal kept only if
+// countSolutions(2) still finds a single solution, until the target number of
+// clues is reached or no clue can go. A puzzle that misses the target clue count
+// or difficulty band is thrown away and a new grid is tried.
+//
+// A generator is not thread safe, but generators share nothing, so one per thread
+// scales with the cores. Seeded the same, a generator produces the same puzzles.
+
+#ifndef __PUZZLE_GENERATOR_
+#define __PUZZLE_GENERATOR_
+
+#include <random>
+#include "Sudoku.h"
+
+class PuzzleGenerator
+{
+public:
+	// by the hardest technique LogicSolver needs: EASY puzzles are solved by
+	// singles alone, MEDIUM need at most intersections, subsets up to triples and
+	// X-wings or swordfish (score 4.0), HARD need more or a search
+	enum Difficulty {ANY, EASY, MEDIUM, HARD};
+
+	explicit PuzzleGenerator(unsigned long long seed = 0);
+	void seed(unsigned long long seed);
+
+	// stop taking clues out at this many, 0 for as few as uniqueness allows
+	void setTargetClues(int clues);
+	void setDifficulty(Difficulty d);
+	// grids tried by one generate() call before it gives up
+	void setMaxAttempts(int attempts);
+
+	// writes a new puzzle as CELLS characters ('0' for empty), and its solution
+	// if solution is not NULL. false if no grid within the attempts hit the
+	// target clue count and difficulty
+	bool generate(char *puzzle, char *solution = NULL);
+
+	static Difficulty rate(const Sudoku &puzzle);
+
+private:
+	std::mt19937_64 rng;
+	int targetClues;
+	Difficulty difficulty;
+	int maxAttempts;
+	Sudoku solver;
+
+	void fullGrid(char *grid);
+	int removeClues(char *grid);
+};
+
+#endif /* __PUZZLE_GENERATOR_ */
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdint.h>
+#include "SolutionCache.h"
+
+// more transforms than this left to try and we give up
+const long MAX_TRANSFORMS = 1 << 14;
+
+// the 6 orders of 3 things
+static const unsigned char ORDERS[6][3] = {
+	{ 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+};
+
+// an order of the 9 rows, or of the 9 columns
+struct LineOrder
+{
+	unsigned char line[9];
+};
+
+void GridTransform::apply(const unsigned char *grid, unsigned char *canonical) const
+{
+	for (int i = 0; i < 9; i++)
+	{
+		for (int j = 0; j < 9; j++)
+		{
+			int r = row[i], c = col[j];
+			canonical[i * 9 + j] = label[transpose ? grid[c * 9 + r] : grid[r * 9 + c]];
+		}
+	}
+}
+
+void GridTransform::invert(const unsigned char *canonical, unsigned char *grid) const
+{
+	unsigned char digit[10];
+	for (int d = 0; d < 10; d++)
+	{
+		digit[label[d]] = d;
+	}
+	for (int i = 0; i < 9; i++)
+	{
+		for (int j = 0; j < 9; j++)
+		{
+			int r = row[i], c = col[j];
+			grid[transpose ? c * 9 + r : r * 9 + c] = digit[canonical[i * 9 + j]];
+		}
+	}
+}
+
+// Signature of every row of g: its number of clues, then the clue counts of the
+// columns its clues are in, largest first, a nibble each. Row and column
+// permutations only move signatures around, so sorting rows by them is the same
+// for every puzzle in a class
+static void rowSignatures(const unsigned char *g, uint64_t *signature)
+{
+	int columnClues[9] = { 0 };
+	for (int cell = 0; cell < 81; cell++)
+	{
+		columnClues[cell % 9] += g[cell] != 0;
+	}
+	for (int r = 0; r < 9; r++)
+	{
+		// insertion sort, largest first
+		int counts[9], clues = 0;
+		for (int c = 0; c < 9; c++)
+		{
+			if (g[r * 9 + c] != 0)
+			{
+				int k = clues++;
+				for (; k > 0 && counts[k - 1] < columnClues[c]; k--)
+				{
+					counts[k] = counts[k - 1];
+				}
+				counts[k] = columnClues[c];
+			}
+		}
+		uint64_t key = clues;
+		for (int k = 0; k < 9; k++)
+		{
+			key = key << 4 | (k < clues ? counts[k] : 0);
+		}
+		signature[r] = key;
+	}
+}
+
+// the orders of the rows putting bands, and rows within a band, in decreasing
+// order of signature, trying every order of equal ones. false if there are
+// more than limit
+static bool lineOrders(const uint64_t *signature, long limit, std::vector<LineOrder> &orders)
+{
+	// a band is keyed by its rows' signatures, largest first
+	uint64_t band[3][3];
+	for (int b = 0; b < 3; b++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			band[b][k] = signature[b * 3 + k];
+		}
+		std::sort(band[b], band[b] + 3, std::greater<uint64_t>());
+	}
+
+	std::vector<int> bandOrders, rowOrders[3];
+	for (int o = 0; o < 6; o++)
+	{
+		const unsigned char *order = ORDERS[o];
+		if (!std::lexicographical_compare(band[order[0]], band[order[0]] + 3, band[order[1]], band[order[1]] + 3) &&
+			!std::lexicographical_compare(band[order[1]], band[order[1]] + 3, band[order[2]], band[order[2]] + 3))
+		{
+			bandOrders.push_back(o);
+		}
+		for (int b = 0; b < 3; b++)
+		{
+			const uint64_t *rows = &signature[b * 3];
+			if (rows[order[0]] >= rows[order[1]] && rows[order[1]] >= rows[order[2]])
+			{
+				rowOrders[b].push_back(o);
+			}
+		}
+	}
+	if ((long)(bandOrders.size() * rowOrders[0].size() * rowOrders[1].size() * rowOrders[2].size()) > limit)
+	{
+		return false;
+	}
+
+	orders.clear();
+	for (size_t o = 0; o < bandOrders.size(); o++)
+	{
+		const unsigned char *bands = ORDERS[bandOrders[o]];
+		for (size_t a = 0; a < rowOrders[bands[0]].size(); a++)
+		{
+			for (size_t b = 0; b < rowOrders[bands[1]].size(); b++)
+			{
+				for (size_t c = 0; c < rowOrders[bands[2]].size(); c++)
+				{
+					const unsigned char *within[3] = {
+						ORDERS[rowOrders[bands[0]][a]], ORDERS[rowOrders[bands[1]][b]], ORDERS[rowOrders[bands[2]][c]]
+					};
+					LineOrder order;
+					for (int k = 0; k < 9; k++)
+					{
+						order.line[k] = bands[k / 3] * 3 + within[k / 3][k % 3];
+					}
+					orders.push_back(order);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// relabels g through the row and column orders, comparing with best as it goes.
+// if the result is smaller it replaces best, its labels go to label and true is
+// returned
+static bool improves(const unsigned char *g, const LineOrder &rows, const LineOrder &columns,
+	unsigned char *best, unsigned char *label, int &nextLabel)
+{
+	unsigned char newLabel[10] = { 0 };
+	int next = 1;
+	bool smaller = false;
+	for (int i = 0; i < 9; i++)
+	{
+		const unsigned char *source = &g[rows.line[i] * 9];
+		for (int j = 0; j < 9; j++)
+		{
+			int d = source[columns.line[j]];
+			if (d != 0 && newLabel[d] == 0)
+			{
+				newLabel[d] = next++;
+			}
+			int value = newLabel[d];
+			if (!smaller)
+			{
+				if (value > best[i * 9 + j])
+				{
+					return false;
+				}
+				smaller = value < best[i * 9 + j];
+			}
+			best[i * 9 + j] = value;
+		}
+	}
+	if (smaller)
+	{
+		memcpy(label, newLabel, sizeof(newLabel));
+		nextLabel = next;
+	}
+	return smaller;
+}
+
+bool canonicalize(const unsigned char *grid, unsigned char *canonical, GridTransform &transform)
+{
+	unsigned char transposed[81];
+	for (int cell = 0; cell < 81; cell++)
+	{
+		transposed[cell] = grid[(cell % 9) * 9 + cell / 9];
+	}
+	const unsigned char *views[2] = { grid, transposed };
+
+	// the rows of one view are the columns of the other
+	std::vector<LineOrder> orders[2];
+	uint64_t signature[9];
+	for (int t = 0; t < 2; t++)
+	{
+		rowSignatures(views[t], signature);
+		if (!lineOrders(signature, MAX_TRANSFORMS, orders[t]))
+		{
+			return false;
+		}
+	}
+	if ((long)orders[0].size() * (long)orders[1].size() > MAX_TRANSFORMS)
+	{
+		return false;
+	}
+
+	// the smallest relabeled grid over both views and every pair of orders left
+	unsigned char best[81];
+	memset(best, 0xFF, sizeof(best));
+	int nextLabel = 1;
+	for (int t = 0; t < 2; t++)
+	{
+		const std::vector<LineOrder> &rows = orders[t], &columns = orders[1 - t];
+		for (size_t r = 0; r < rows.size(); r++)
+		{
+			for (size_t c = 0; c < columns.size(); c++)
+			{
+				if (improves(views[t], rows[r], columns[c], best, transform.label, nextLabel))
+				{
+					transform.transpose = t != 0;
+					memcpy(transform.row, rows[r].line, 9);
+					memcpy(transform.col, columns[c].line, 9);
+				}
+			}
+		}
+	}
+
+	// digits that do not appear take the labels left over, in order
+	for (int d = 1; d <= 9; d++)
+	{
+		if (transform.label[d] == 0)
+		{
+			transform.label[d] = nextLabel++;
+		}
+	}
+	memcpy(canonical, best, sizeof(best));
+	return true;
+}
+
+SolutionCache::SolutionCache(size_t capacity)
+	: hitCount(0), missCount(0)
+{
+	shardCapacity = (capacity + SHARDS - 1) / SHARDS;
+	if (shardCapacity == 0)
+	{
+		shardCapacity = 1;
+	}
+}
+
+long SolutionCache::hits() const
+{
+	return hitCount;
+}
+
+long SolutionCache::misses() const
+{
+	return missCount;
+}
+
+size_t SolutionCache::size() const
+{
+	size_t total = 0;
+	for (int s = 0; s < SHARDS; s++)
+	{
+		std::lock_guard<std::mutex> hold(shards[s].lock);
+		total += shards[s].entries.size();
+	}
+	return total;
+}
+
+SolutionCache::Shard &SolutionCache::shardOf(const std::string &key)
+{
+	return shards[std::hash<std::string>()(key) % SHARDS];
+}
+
+bool SolutionCache::lookup(const std::string &key, std::string &solution)
+{
+	Shard &shard = shardOf(key);
+	std::lock_guard<std::mutex> hold(shard.lock);
+	std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = shard.find.find(key);
+	if (found == shard.find.end())
+	{
+		return false;
+	}
+	shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+	solution = found->second->solution;
+	return true;
+}
+
+void SolutionCache::insert(const std::string &key, const std::string &solution)
+{
+	Shard &shard = shardOf(key);
+	std::lock_guard<std::mutex> hold(shard.lock);
+	// another thread may have solved the same class meanwhile
+	if (shard.find.count(key) != 0)
+	{
+		return;
+	}
+	if (shard.entries.size() == shardCapacity)
+	{
+		shard.find.erase(shard.entries.back().key);
+		shard.entries.pop_back();
+	}
+	Entry entry = { key, solution };
+	shard.entries.push_front(entry);
+	shard.find[key] = shard.entries.begin();
+}
+
+bool SolutionCache::solve(Sudoku &puzzle)
+{
+	char line[Sudoku::CELLS];
+	unsigned char grid[Sudoku::CELLS], canonical[Sudoku::CELLS];
+	GridTransform transform;
+
+	puzzle.toLine(line);
+	for (int cell = 0; cell < Sudoku::CELLS; cell++)
+	{
+		grid[cell] = line[cell] - '0';
+	}
+	if (!canonicalize(grid, canonical, transform))
+	{
+		missCount++;
+		return puzzle.solve();
+	}
+
+	std::string key((const char *)canonical, Sudoku::CELLS), solution;
+	if (lookup(key, solution))
+	{
+		hitCount++;
+		if (solution.empty())
+		{
+			return false;
+		}
+		transform.invert((const unsigned char *)solution.data(), grid);
+		for (int cell = 0; cell < Sudoku::CELLS; cell++)
+		{
+			line[cell] = '0' + grid[cell];
+		}
+		return puzzle.loadFromLine(line, Sudoku::CELLS);
+	}
+
+	missCount++;
+	bool solved = puzzle.solve();
+	if (solved)
+	{
+		puzzle.toLine(line);
+		for (int cell = 0; cell < Sudoku::CELLS; cell++)
+		{
+			grid[cell] = line[cell] - '0';
+		}
+		transform.apply(grid, canonical);
+		solution.assign((const char *)canonical, Sudoku::CELLS);
+	}
+	insert(key, solution);
+	return solved;
+}
@@ -0,0 +1,91 @@
+// Canonical forms of 9x9 puzzles and a cache of solutions keyed by them.
+//
+// Two puzzles are equivalent when one turns into the other by relabeling the
+// digits, transposing, permuting the bands and the rows inside a band, and
+// permuting the stacks and the columns inside a stack. Every such transform maps
+// the solutions of one puzzle onto the solutions of the other, so a solution only
+// has to be found once per class.
+//
+// The canonical form is the lexicographically smallest grid, read row by row with
+// empty cells as 0 and digits relabeled 1, 2, ... in order of first appearance,
+// among the transforms that sort bands, rows, stacks and columns by clue-count
+// signatures that the transforms themselves cannot change. Only lines with equal
+// signatures are permuted, which leaves a few dozen grids to compare for a
+// typical puzzle instead of millions.
+
+#ifndef __SOLUTION_CACHE_
+#define __SOLUTION_CACHE_
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Sudoku.h"
+
+// maps a grid onto its canonical form and back. cells are 0 (empty) to 9
+struct GridTransform
+{
+	bool transpose;
+	unsigned char row[9];		// canonical row i comes from row[i] of the (transposed) grid
+	unsigned char col[9];		// canonical column j from column col[j]
+	unsigned char label[10];	// canonical digit of each digit, label[0] == 0
+
+	void apply(const unsigned char *grid, unsigned char *canonical) const;
+	void invert(const unsigned char *canonical, unsigned char *grid) const;
+};
+
+// finds the canonical form of grid and the transform that produces it. gives up
+// and returns false on grids so symmetric (the empty grid, say) that too many
+// transforms tie
+bool canonicalize(const unsigned char *grid, unsigned char *canonical, GridTransform &transform);
+
+// Bounded LRU cache from canonical puzzle to canonical solution, safe to share
+// between threads. It is split into shards with a lock each so that workers
+// looking up different puzzles rarely wait for each other.
+class SolutionCache
+{
+public:
+	explicit SolutionCache(size_t capacity);
+
+	// solves puzzle like puzzle.solve(), answering from the cache when an
+	// equivalent puzzle was solved before and remembering the answer otherwise.
+	// unsolvable puzzles are cached too. a puzzle with several solutions gets
+	// the one found for the first puzzle of its class
+	bool solve(Sudoku &puzzle);
+
+	long hits() const;
+	long misses() const;
+	size_t size() const;
+
+private:
+	enum { SHARDS = 16 };
+
+	struct Entry
+	{
+		std::string key;
+		std::string solution;	// canonical solution, empty if there is none
+	};
+
+	struct Shard
+	{
+		mutable std::mutex lock;
+		std::list<Entry> entries;	// most recently used first
+		std::unordered_map<std::string, std::list<Entry>::iterator> find;
+	};
+
+	Shard shards[SHARDS];
+	size_t shardCapacity;
+	std::atomic<long> hitCount;
+	std::atomic<long> missCount;
+
+	Shard &shardOf(const std::string &key);
+	bool lookup(const std::string &key, std::string &solution);
+	void insert(const std::string &key, const std::string &solution);
+
+	SolutionCache(const SolutionCache &);
+	SolutionCache &operator=(const SolutionCache &);
+};
+
+#endif /* __SOLUTION_CACHE_ */
@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "SolverServer.h"
+#include "SolutionCache.h"
+
+const int READ_SIZE = 1 << 16;		// bytes read from a connection at a time
+const int BATCH_LINES = 256;		// puzzles per pool task
+const size_t MAX_LINE = 1024;		// longer lines are answered as bad puzzles
+
+static bool setNonBlocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+SolverServer::SolverServer(const char *socketPath, int queueLimit, SolutionCache *cache)
+	: path(socketPath), stopping(false), solvers(pool.size())
+{
+	this->queueLimit = queueLimit > 0 ? queueLimit : 1;
+	this->cache = cache;
+	listenFd = -1;
+	wakeFds[0] = wakeFds[1] = -1;
+	queued = 0;
+	for (size_t w = 0; w < solvers.size(); w++)
+	{
+		solvers[w].setEngine(Sudoku::DANCING_LINKS);
+	}
+}
+
+SolverServer::~SolverServer()
+{
+	// tasks still running use the solvers and the wake pipe
+	pool.wait();
+	for (size_t n = 0; n < connections.size(); n++)
+	{
+		close(connections[n]->fd);
+	}
+	if (listenFd >= 0)
+	{
+		close(listenFd);
+		unlink(path.c_str());
+	}
+	for (int n = 0; n < 2; n++)
+	{
+		if (wakeFds[n] >= 0)
+		{
+			close(wakeFds[n]);
+		}
+	}
+}
+
+int SolverServer::workers() const
+{
+	return pool.size();
+}
+
+bool SolverServer::start()
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+	strcpy(address.sun_path, path.c_str());
+
+	// a socket left behind by a server that died is in the way of bind()
+	struct stat info;
+	if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+	{
+		unlink(path.c_str());
+	}
+
+	// a client that hangs up must not kill the server with SIGPIPE
+	signal(SIGPIPE, SIG_IGN);
+
+	if (pipe(wakeFds) != 0 || !setNonBlocking(wakeFds[0]) || !setNonBlocking(wakeFds[1]))
+	{
+		return false;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+	if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	listenFd = fd;
+	return listen(fd, SOMAXCONN) == 0 && setNonBlocking(fd);
+}
+
+void SolverServer::stop()
+{
+	stopping = true;
+	wake();
+}
+
+void SolverServer::wake()
+{
+	// if the pipe is full the poll is woken already
+	char byte = 1;
+	if (::write(wakeFds[1], &byte, 1) < 0)
+	{
+		return;
+	}
+}
+
+void SolverServer::run()
+{
+	std::vector<pollfd> polled;
+	while (!stopping)
+	{
+		// wake pipe, listening socket, then one entry per connection. a connection
+		// is not read from while the queue or its answers are at the limit
+		polled.clear();
+		pollfd wakeEntry = { wakeFds[0], POLLIN, 0 };
+		pollfd listenEntry = { listenFd, POLLIN, 0 };
+		polled.push_back(wakeEntry);
+		polled.push_back(listenEntry);
+		for (size_t n = 0; n < connections.size(); n++)
+		{
+			Connection &c = *connections[n];
+			pollfd entry = { c.fd, 0, 0 };
+			if (!c.endOfInput && !c.broken && !c.waiting && queued < queueLimit && c.owed < queueLimit)
+			{
+				entry.events |= POLLIN;
+			}
+			if (!c.writeBuffer.empty() && !c.broken)
+			{
+				entry.events |= POLLOUT;
+			}
+			// poll skips negative descriptors, or a hung up connection waiting for
+			// its last answers would report POLLHUP over and over
+			if (entry.events == 0)
+			{
+				entry.fd = -1;
+			}
+			polled.push_back(entry);
+		}
+		if (poll(&polled[0], polled.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (polled[0].revents & POLLIN)
+		{
+			char drain[256];
+			while (::read(wakeFds[0], drain, sizeof(drain)) > 0)
+			{
+			}
+		}
+		for (size_t n = 0; n < connections.size(); n++)
+		{
+			if ((polled[n + 2].events & POLLIN) && (polled[n + 2].revents & (POLLIN | POLLHUP | POLLERR)))
+			{
+				readFrom(*connections[n]);
+			}
+		}
+		if (polled[1].revents & POLLIN)
+		{
+			accept();
+		}
+
+		// send what is finished, in order, and drop connections that are done
+		for (size_t n = 0; n < connections.size(); )
+		{
+			Connection &c = *connections[n];
+			collect(c);
+			writeTo(c);
+			if ((c.endOfInput || c.broken) && c.batches.empty() && (c.writeBuffer.empty() || c.broken) &&
+				(!c.waiting || c.broken))
+			{
+				close(c.fd);
+				connections.erase(connections.begin() + n);
+			}
+			else
+			{
+				n++;
+			}
+		}
+		// then queue the lines held back, now that answers have made room
+		for (size_t n = 0; n < connections.size(); n++)
+		{
+			if (connections[n]->waiting && !connections[n]->broken)
+			{
+				submitLines(*connections[n]);
+			}
+		}
+	}
+}
+
+void SolverServer::accept()
+{
+	for (;;)
+	{
+		int fd = ::accept(listenFd, NULL, NULL);
+		if (fd < 0)
+		{
+			return;
+		}
+		if (!setNonBlocking(fd))
+		{
+			close(fd);
+			continue;
+		}
+		std::unique_ptr<Connection> c(new Connection);
+		c->fd = fd;
+		c->owed = 0;
+		c->waiting = false;
+		c->endOfInput = false;
+		c->broken = false;
+		c->skippingLine = false;
+		connections.push_back(std::move(c));
+	}
+}
+
+void SolverServer::readFrom(Connection &c)
+{
+	char buffer[READ_SIZE];
+	ssize_t got = ::read(c.fd, buffer, sizeof(buffer));
+	if (got < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			c.broken = true;
+		}
+		return;
+	}
+	if (got == 0)
+	{
+		// a last line without a newline still counts
+		c.endOfInput = true;
+		submitLines(c);
+		return;
+	}
+
+	// the rest of an overlong line, already answered
+	const char *data = buffer;
+	if (c.skippingLine)
+	{
+		const char *newline = (const char *)memchr(data, '\n', got);
+		if (newline == NULL)
+		{
+			return;
+		}
+		got -= newline + 1 - data;
+		data = newline + 1;
+		c.skippingLine = false;
+	}
+
+	c.readBuffer.append(data, got);
+	submitLines(c);
+}
+
+// queues the lines in c's read buffer as far as the queue and c's answers have
+// room, and keeps the rest there for later
+void SolverServer::submitLines(Connection &c)
+{
+	size_t used = 0;
+	size_t end = c.readBuffer.rfind('\n');
+	if (end != std::string::npos)
+	{
+		used = submit(c, c.readBuffer.data(), end + 1, std::min(queueLimit - queued, queueLimit - c.owed));
+	}
+	if (end == std::string::npos || used == end + 1)
+	{
+		// no complete line left. the rest is a line still coming in, unless it is
+		// too long already or the input has ended
+		size_t rest = c.readBuffer.size() - used;
+		if ((rest > MAX_LINE || (c.endOfInput && rest > 0)) && queued < queueLimit && c.owed < queueLimit)
+		{
+			submit(c, c.readBuffer.data() + used, std::min(rest, MAX_LINE), 1);
+			c.skippingLine = rest > MAX_LINE && !c.endOfInput;
+			used = c.readBuffer.size();
+		}
+	}
+	c.readBuffer.erase(0, used);
+	c.waiting = c.readBuffer.find('\n') != std::string::npos || c.readBuffer.size() > MAX_LINE ||
+		(c.endOfInput && !c.readBuffer.empty());
+}
+
+// cuts data into lines and queues up to lines of them in batches of up to
+// BATCH_LINES. returns the bytes of data used
+size_t SolverServer::submit(Connection &c, const char *data, size_t length, long lines)
+{
+	const char *next = data, *end = data + length;
+	while (next < end && lines > 0)
+	{
+		std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+		while (next < end && lines > 0 && (int)batch->start.size() < BATCH_LINES)
+		{
+			const char *line = next;
+			const char *newline = (const char *)memchr(line, '\n', end - line);
+			next = newline != NULL ? newline + 1 : end;
+			int size = (newline != NULL ? newline : end) - line;
+			if (size == 0 || (size == 1 && line[0] == '\r'))
+			{
+				continue;
+			}
+			batch->start.push_back(batch->input.size());
+			batch->length.push_back(size);
+			batch->input.append(line, size);
+			lines--;
+		}
+		if (batch->start.empty())
+		{
+			break;
+		}
+
+		queued += batch->start.size();
+		c.owed += batch->start.size();
+		c.batches.push_back(batch);
+		pool.submit([this, batch](int worker)
+		{
+			solveBatch(*batch, worker);
+			batch->done.store(true, std::memory_order_release);
+			wake();
+		});
+	}
+	return next - data;
+}
+
+void SolverServer::solveBatch(Batch &batch, int worker)
+{
+	Sudoku &puzzle = solvers[worker];
+	char answer[128];
+	for (size_t n = 0; n < batch.start.size(); n++)
+	{
+		if (!puzzle.loadFromLine(&batch.input[batch.start[n]], batch.length[n]))
+		{
+			batch.output += "Bad Puzzle\n";
+			continue;
+		}
+		std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+		bool solved = cache != NULL ? cache->solve(puzzle) : puzzle.solve();
+		double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+		if (solved)
+		{
+			puzzle.toLine(answer);
+			batch.output.append(answer, Sudoku::CELLS);
+			batch.output.append(answer, sprintf(answer, " %.1f\n", micros));
+		}
+		else
+		{
+			batch.output.append(answer, sprintf(answer, "No Solution %.1f\n", micros));
+		}
+	}
+}
+
+// moves the answers of finished batches, in request order, to the write buffer
+void SolverServer::collect(Connection &c)
+{
+	while (!c.batches.empty() && c.batches.front()->done.load(std::memory_order_acquire))
+	{
+		Batch &batch = *c.batches.front();
+		queued -= batch.start.size();
+		if (!c.broken)
+		{
+			c.writeBuffer += batch.output;
+		}
+		else
+		{
+			c.owed -= batch.start.size();
+		}
+		c.batches.pop_front();
+	}
+}
+
+void SolverServer::writeTo(Connection &c)
+{
+	if (c.broken || c.writeBuffer.empty())
+	{
+		return;
+	}
+	ssize_t sent = ::write(c.fd, c.writeBuffer.data(), c.writeBuffer.size());
+	if (sent < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			c.broken = true;
+		}
+		return;
+	}
+	// every answer is one line
+	c.owed -= std::count(c.writeBuffer.begin(), c.writeBuffer.begin() + sent, '\n');
+	c.writeBuffer.erase(0, sent);
+}
@@ -0,0 +1,95 @@
+// Puzzle solving service on a Unix domain socket.
+//
+// Clients connect to the socket and write puzzles in the one-line corpus format,
+// one per line, as many and as fast as they like. For each puzzle the server
+// writes back one line, in the order the puzzles came in on that connection:
+//   <81 digits> <microseconds>       the solution and the time spent solving
+//   No Solution <microseconds>
+//   Bad Puzzle                       also for lines over 1024 characters
+//
+// One thread does all the socket I/O with poll(). The complete lines of every read
+// become a batch that a ThreadPool worker solves with its own warm solver. At most
+// queueLimit puzzles are waiting or being solved at any time, and a connection owes
+// at most queueLimit answers, queued or solved but not yet written. Lines past
+// either limit stay unread in the connection's buffer and the server stops
+// reading it, so fast clients, and clients that do not read their answers, block
+// on a full socket instead of growing the server (backpressure).
+
+#ifndef __SOLVER_SERVER_
+#define __SOLVER_SERVER_
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Sudoku.h"
+#include "ThreadPool.h"
+
+class SolutionCache;
+
+class SolverServer
+{
+public:
+	// cache may be NULL, otherwise it is shared by all workers
+	SolverServer(const char *socketPath, int queueLimit = 4096, SolutionCache *cache = NULL);
+	~SolverServer();
+
+	// binds and listens on the socket, replacing a stale one. false on error
+	bool start();
+	// serves clients until stop() is called
+	void run();
+	// makes run() return. safe to call from a signal handler or another thread
+	void stop();
+
+	int workers() const;
+
+private:
+	// lines read together from one connection, solved by one pool task
+	struct Batch
+	{
+		std::string input;
+		std::vector<int> start, length;		// the lines within input
+		std::string output;
+		std::atomic<bool> done;
+		Batch() : done(false) {}
+	};
+
+	struct Connection
+	{
+		int fd;
+		std::string readBuffer;
+		std::string writeBuffer;
+		std::deque<std::shared_ptr<Batch> > batches;	// in request order
+		long owed;			// lines submitted whose answer is not written yet
+		bool waiting;		// readBuffer holds lines the limits kept back
+		bool endOfInput;
+		bool broken;		// a read or write failed, answers are dropped
+		bool skippingLine;	// dropping input up to the next newline
+	};
+
+	std::string path;
+	int queueLimit;
+	SolutionCache *cache;
+	int listenFd;
+	int wakeFds[2];					// a worker or stop() writes a byte to wake the poll
+	std::atomic<bool> stopping;
+	long queued;					// puzzles in batches not yet written back
+	std::vector<std::unique_ptr<Connection> > connections;
+	ThreadPool pool;
+	std::vector<Sudoku> solvers;	// one per worker
+
+	void accept();
+	void readFrom(Connection &c);
+	void submitLines(Connection &c);
+	size_t submit(Connection &c, const char *data, size_t length, long lines);
+	void collect(Connection &c);
+	void writeTo(Connection &c);
+	void solveBatch(Batch &batch, int worker);
+	void wake();
+
+	SolverServer(const SolverServer &);
+	SolverServer &operator=(const SolverServer &);
+};
+
+#endif /* __SOLVER_SERVER_ */
@@ -1,43 +1,237 @@
 
 #include <ctime>
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <string>
 #include <stdlib.h>
 #include <stdexcept>
 #include <cmath>
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include "Sudoku.h"
+#include "DancingLinks.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include "SudokuKernels.h"
 
 using namespace std;
 
-Sudoku::Sudoku()
+// steady clock in seconds, for the statistics
+static inline double secondsNow()
 {
-	for (int i = 0; i < 9; i++)
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <int N>
+BasicSudoku<N>::BasicSudoku()
+{
+	for (int i = 0; i < SIZE; i++)
 	{
-		for (int j = 0; j < 9; j++)
+		for (int j = 0; j < SIZE; j++)
 		{
-			puz[i][j] = 0;
+			state.puz[i][j] = 0;
 		}
 	}
+	rebuildMasks();
+	trailLen = 0;
+	mode = FIRST_EMPTY;
+	engine = BACKTRACKING;
+	depth = 0;
+	suspended = false;
+	nodes = 0;
+	trace = NULL;
+	level = 0;
+	conflictPairs = disagreeing = 0;
+	haveKnown = false;
 }
 
 
 
-void Sudoku::loadFromFile (string filename)
+// reads the puzzle in filename, see loadFromBuffer() for the formats. returns false
+// and leaves the grid empty if the file is missing, short, too long or not a puzzle
+template <int N>
+bool BasicSudoku<N>::loadFromFile (string filename)
 {
-	
-		ifstream puzzle_file2(filename, ifstream::in);
-		int data, r, c;
-		int counter = 0;
-		int max = 9;
-		while (puzzle_file2 >> data) 
+	MappedFile file(filename.c_str());
+	if (!file.isOpen())
+	{
+		return loadFromBuffer("", 0);
+	}
+	return loadFromBuffer(file.data(), file.size());
+}
+
+static inline bool isSpace(char ch)
+{
+	return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\f' || ch == '\v';
+}
+
+// character used for digit k in the one-line format: 1-9, then A, B, ... for the
+// bigger boards
+static inline char digitChar(int k)
+{
+	return k <= 9 ? '0' + k : 'A' + (k - 10);
+}
+
+// digit for a character of the one-line format, 0 for an empty cell, -1 if invalid
+static inline int charDigit(char ch)
+{
+	if (ch == '0' || ch == '.')
+		return 0;
+	if (ch >= '1' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'A' && ch <= 'Z')
+		return ch - 'A' + 10;
+	if (ch >= 'a' && ch <= 'z')
+		return ch - 'a' + 10;
+	return -1;
+}
+
+// reads one puzzle from memory, in either of two formats:
+//   - CELLS whitespace separated numbers, like test.txt, 0 or . for an empty cell
+//   - one token of exactly CELLS characters, as in loadFromLine()
+// with consumed == NULL anything but whitespace after the puzzle is an error;
+// otherwise it is set to the number of bytes used, so the next puzzle of a corpus
+// can be read from data + *consumed. returns false and leaves the grid empty if
+// there is no complete puzzle
+template <int N>
+bool BasicSudoku<N>::loadFromBuffer(const char *data, size_t length, size_t *consumed)
+{
+	const char *p = data, *end = data + length;
+	while (p < end && isSpace(*p))
+	{
+		p++;
+	}
+	const char *token = p;
+	while (token < end && !isSpace(*token))
+	{
+		token++;
+	}
+
+	bool ok = true;
+	if (token - p == CELLS)
+	{
+		for (int cell = 0; cell < CELLS; cell++)
+		{
+			int k = charDigit(p[cell]);
+			if (k < 0 || k > SIZE)
+			{
+				k = 0;
+				ok = false;
+			}
+			state.puz[cell / SIZE][cell % SIZE] = k;
+		}
+		p = token;
+	}
+	else
+	{
+		for (int cell = 0; cell < CELLS; cell++)
+		{
+			while (p < end && isSpace(*p))
+			{
+				p++;
+			}
+			int k = 0;
+			if (p < end && *p == '.')
+			{
+				p++;
+			}
+			else if (p < end && *p >= '0' && *p <= '9')
+			{
+				while (p < end && *p >= '0' && *p <= '9')
+				{
+					if (k <= SIZE)
+					{
+						k = k * 10 + (*p - '0');
+					}
+					p++;
+				}
+			}
+			else
+			{
+				ok = false;		// end of data, or not a number
+			}
+			if (k > SIZE || (p < end && !isSpace(*p)))
+			{
+				ok = false;
+			}
+			if (!ok)
+			{
+				break;
+			}
+			state.puz[cell / SIZE][cell % SIZE] = k;
+		}
+	}
+
+	if (consumed != NULL)
+	{
+		*consumed = p - data;
+	}
+	else
+	{
+		while (p < end && isSpace(*p))
+		{
+			p++;
+		}
+		ok = ok && p == end;
+	}
+	if (!ok)
+	{
+		for (int cell = 0; cell < CELLS; cell++)
+		{
+			state.puz[cell / SIZE][cell % SIZE] = 0;
+		}
+	}
+	rebuildMasks();
+	suspended = false;
+	return ok;
+}
+
+// reads a puzzle written as CELLS characters on one line (81 for 9x9), '0' or '.'
+// for an empty cell. trailing whitespace is ignored. returns false and leaves the
+// grid empty if the line is not a puzzle
+template <int N>
+bool BasicSudoku<N>::loadFromLine(const char *line, int length)
+{
+	while (length > CELLS && (line[length - 1] == '\r' || line[length - 1] == ' ' || line[length - 1] == '\t'))
+	{
+		length--;
+	}
+	bool ok = (length == CELLS);
+	for (int cell = 0; cell < CELLS; cell++)
+	{
+		int k = 0;
+		if (ok)
+		{
+			k = charDigit(line[cell]);
+			if (k < 0 || k > SIZE)
+			{
+				k = 0;
+				ok = false;
+			}
+		}
+		state.puz[cell / SIZE][cell % SIZE] = k;
+	}
+	if (!ok)
+	{
+		for (int cell = 0; cell < CELLS; cell++)
 		{
-			c = counter%9;
-			r = counter/9;
-			puz[r][c]= data;
-			counter++;
+			state.puz[cell / SIZE][cell % SIZE] = 0;
 		}
+	}
+	rebuildMasks();
+	suspended = false;
+	return ok;
+}
+
+// writes the grid as CELLS characters, no terminator
+template <int N>
+void BasicSudoku<N>::toLine(char *out) const
+{
+	for (int cell = 0; cell < CELLS; cell++)
+	{
+		out[cell] = state.puz[cell / SIZE][cell % SIZE] == 0 ? '0' : digitChar(state.puz[cell / SIZE][cell % SIZE]);
+	}
 }
 	
 	
@@ -46,137 +240,1080 @@ void Sudoku::loadFromFile (string filename)
 
 
 
-bool Sudoku::solve()
+// reads a grid written by toPacked(). returns false and leaves the grid empty if a
+// cell holds something other than 0..SIZE
+template <int N>
+bool BasicSudoku<N>::loadFromPacked(const unsigned char *in)
+{
+	bool ok = true;
+	for (int cell = 0; cell < CELLS; cell++)
+	{
+		int k;
+		if (SIZE < 16)
+			k = (cell & 1) ? in[cell / 2] >> 4 : in[cell / 2] & 0x0F;
+		else
+			k = in[cell];
+		if (k > SIZE)
+		{
+			k = 0;
+			ok = false;
+		}
+		state.puz[cell / SIZE][cell % SIZE] = k;
+	}
+	if (!ok)
+	{
+		for (int cell = 0; cell < CELLS; cell++)
+		{
+			state.puz[cell / SIZE][cell % SIZE] = 0;
+		}
+	}
+	rebuildMasks();
+	suspended = false;
+	return ok;
+}
+
+// writes the grid in PACKED_BYTES bytes, 0 for an empty cell. for boards up to 9x9
+// each byte holds two cells, the first one in the low 4 bits
+template <int N>
+void BasicSudoku<N>::toPacked(unsigned char *out) const
+{
+	for (int n = 0; n < PACKED_BYTES; n++)
+	{
+		out[n] = 0;
+	}
+	for (int cell = 0; cell < CELLS; cell++)
+	{
+		int k = state.puz[cell / SIZE][cell % SIZE];
+		if (SIZE < 16)
+			out[cell / 2] |= (cell & 1) ? k << 4 : k;
+		else
+			out[cell] = k;
+	}
+}
+
+template <int N>
+bool BasicSudoku<N>::solve()
+{
+	countsStale = true;
+	suspended = false;
+	nodes = 0;
+	SUDOKU_STAT(startStats(); double started = secondsNow());
+
+	bool solved;
+	if (engine == DANCING_LINKS)
+	{
+		// one matrix per thread, built on first use and reused for every puzzle
+		static thread_local unique_ptr<DancingLinks<N> > links;
+		if (!links)
+		{
+			links.reset(new DancingLinks<N>);
+		}
+		SUDOKU_STAT(links->setTrace(trace));
+		solved = links->solve(&state.puz[0][0]);
+		nodes = links->nodeCount();
+		SUDOKU_STAT(stats.backtracks = links->statistics().backtracks;
+			stats.maxDepth = links->statistics().maxDepth);
+		rebuildMasks();
+	}
+	else if (mode == MOST_CONSTRAINED)
+	{
+		trailLen = 0;
+		solved = searchMostConstrained();
+	}
+	else if (mode == SNAPSHOT)
+	{
+		State givens = state;
+		trailLen = 0;
+		solved = searchSnapshot();
+		if (!solved)
+		{
+			state = givens;
+		}
+	}
+	else
+	{
+		solved = backtrack();
+	}
+
+	SUDOKU_STAT(finishStats(solved ? SOLVED : NO_SOLUTION, started));
+	return solved;
+}
+
+template <int N>
+void BasicSudoku<N>::setSearchMode(SearchMode m)
+{
+	mode = m;
+}
+
+template <int N>
+void BasicSudoku<N>::setEngine(Engine e)
+{
+	engine = e;
+}
+
+// same search as MOST_CONSTRAINED, but with an explicit stack so it can stop
+// when the budget runs out. whatever was placed so far stays on the grid
+template <int N>
+SudokuBase::Status BasicSudoku<N>::solveWithin(const Budget &budget)
+{
+	trailLen = 0;
+	depth = 0;
+	nodes = 0;
+	SUDOKU_STAT(startStats(); double started = secondsNow());
+	Status status = runSearch(budget);
+	SUDOKU_STAT(finishStats(status, started));
+	return status;
+}
+
+// continues a search that returned BUDGET_EXHAUSTED, with a fresh budget
+template <int N>
+SudokuBase::Status BasicSudoku<N>::resume(const Budget &budget)
+{
+	if (!suspended)
+	{
+		return solveWithin(budget);
+	}
+	SUDOKU_STAT(double started = secondsNow());
+	Status status = runSearch(budget);
+	SUDOKU_STAT(finishStats(status, started));
+	return status;
+}
+
+// runs the explicit stack search, entering a new node at the current grid first
+template <int N>
+SudokuBase::Status BasicSudoku<N>::runSearch(const Budget &budget)
+{
+	chrono::steady_clock::time_point deadline;
+	if (budget.microseconds > 0)
+	{
+		deadline = chrono::steady_clock::now() + chrono::microseconds(budget.microseconds);
+	}
+	long used = 0;
+	bool descend = true;
+	suspended = false;
+	countsStale = true;
+
+	for (;;)
+	{
+		if (descend)
+		{
+			// budget checks happen before a node is entered, so resume() picks up here
+			if (budget.nodes > 0 && used >= budget.nodes)
+			{
+				suspended = true;
+				return BUDGET_EXHAUSTED;
+			}
+			if ((used & 63) == 0 && used > 0)
+			{
+				if ((budget.cancel != NULL && budget.cancel->load(memory_order_relaxed)) ||
+					(budget.microseconds > 0 && chrono::steady_clock::now() >= deadline))
+				{
+					suspended = true;
+					return BUDGET_EXHAUSTED;
+				}
+			}
+			used++;
+			nodes++;
+
+			int mark = trailLen;
+			if (!propagate())
+			{
+				undoTo(mark);
+				descend = false;
+				continue;
+			}
+
+			int best = mostConstrainedCell();
+			if (best < 0)
+			{
+				return SOLVED;
+			}
+
+			Frame &f = frames[depth++];
+			f.cell = best;
+			f.untried = candidates(Geometry::rowOf(best), Geometry::colOf(best));
+			f.mark = mark;
+			f.base = trailLen;
+			descend = false;
+		}
+
+		// try the next candidate of the deepest frame, popping exhausted frames
+		if (depth == 0)
+		{
+			return NO_SOLUTION;
+		}
+		Frame &f = frames[depth - 1];
+		SUDOKU_STAT(if (level == depth) leaveBranch());		// the last digit tried here failed
+		undoTo(f.base);
+		if (f.untried == 0)
+		{
+			undoTo(f.mark);
+			depth--;
+			continue;
+		}
+		int num = __builtin_ctz(f.untried) + 1;
+		f.untried &= f.untried - 1;
+		push(Geometry::rowOf(f.cell), Geometry::colOf(f.cell), num);
+		SUDOKU_STAT(enterBranch(f.cell, num));
+		descend = true;
+	}
+}
+
+// counts the solutions of the current grid, giving up once limit have been found,
+// so countSolutions(2) == 1 proves the puzzle is unique. the grid is left as it was
+template <int N>
+long BasicSudoku<N>::countSolutions(long limit)
+{
+	atomic<long> found(0);
+	trailLen = 0;
+	suspended = false;
+	nodes = 0;
+	SUDOKU_STAT(startStats(); double started = secondsNow());
+	countFrom(limit, found);
+	undoTo(0);
+	SUDOKU_STAT(finishStats(found > 0 ? SOLVED : NO_SOLUTION, started));
+	return found;
+}
+
+// same count, with the top of the search tree split into pool tasks. idle workers
+// steal the subtrees, and every worker stops as soon as the limit is reached.
+// must not be called from a task running on the same pool
+template <int N>
+long BasicSudoku<N>::countSolutions(long limit, ThreadPool &pool)
+{
+	atomic<long> found(0);
+
+	// branch about log2(8 * workers) levels deep before counting sequentially,
+	// which gives each worker several subtrees to balance uneven ones
+	int splitDepth = 0;
+	while ((1 << splitDepth) < 8 * pool.size())
+	{
+		splitDepth++;
+	}
+
+	nodes = 0;	// each task counts on its own copy
+	BasicSudoku root(*this);
+	root.trailLen = 0;
+	root.suspended = false;
+	root.trace = NULL;		// a trace is not shared between threads
+	pool.submit([root, limit, splitDepth, &found, &pool](int) mutable
+	{
+		root.countSplit(limit, splitDepth, found, pool);
+	});
+	pool.wait();
+
+	long count = found;
+	return count < limit ? count : limit;
+}
+
+// adds the solutions below the current grid to found, stopping once it reaches limit
+template <int N>
+void BasicSudoku<N>::countFrom(long limit, atomic<long> &found)
+{
+	nodes++;
+	if (found.load(memory_order_relaxed) >= limit)
+	{
+		return;
+	}
+	int mark = trailLen;
+	if (!propagate())
+	{
+		undoTo(mark);
+		return;
+	}
+
+	int best = mostConstrainedCell();
+	if (best < 0)
+	{
+		found++;
+		undoTo(mark);
+		return;
+	}
+
+	int row = Geometry::rowOf(best), col = Geometry::colOf(best);
+	Mask cand = candidates(row, col);
+	while (cand != 0 && found.load(memory_order_relaxed) < limit)
+	{
+		int num = __builtin_ctz(cand) + 1;
+		cand &= cand - 1;
+		int branch = trailLen;
+		push(row, col, num);
+		SUDOKU_STAT(enterBranch(best, num));
+		countFrom(limit, found);
+		SUDOKU_STAT(leaveBranch());
+		undoTo(branch);
+	}
+	undoTo(mark);
+}
+
+// runs on a private copy of the grid: branches once and hands each child to the
+// pool, or counts sequentially when splitDepth reaches 0
+template <int N>
+void BasicSudoku<N>::countSplit(long limit, int splitDepth, atomic<long> &found, ThreadPool &pool)
+{
+	if (splitDepth == 0)
+	{
+		countFrom(limit, found);
+		return;
+	}
+	if (found.load(memory_order_relaxed) >= limit || !propagate())
+	{
+		return;
+	}
+
+	int best = mostConstrainedCell();
+	if (best < 0)
+	{
+		found++;
+		return;
+	}
+
+	int row = Geometry::rowOf(best), col = Geometry::colOf(best);
+	Mask cand = candidates(row, col);
+	while (cand != 0)
+	{
+		int num = __builtin_ctz(cand) + 1;
+		cand &= cand - 1;
+		BasicSudoku child(*this);
+		child.push(row, col, num);
+		pool.submit([child, limit, splitDepth, &found, &pool](int) mutable
+		{
+			child.countSplit(limit, splitDepth - 1, found, pool);
+		});
+	}
+}
+
+// plain depth first search, branching on the first empty cell
+template <int N>
+bool BasicSudoku<N>::backtrack()
 {
+	nodes++;
     int row, col;
 
 	if (!SpotLeft(row, col))
 	{
        return true;
 	}
-    for (int num = 1; num <= 9; num++)
+	// try the legal digits in increasing order, same as the old 1..9 loop
+	Mask cand = candidates(row, col);
+    while (cand != 0)
     {
-        if (isLegal(row, col, num))
-        {
-            puz[row][col] = num;
-            if (solve())
-			{
-                return true;
-			}
-            puz[row][col] = 0;
-        }
+		int num = __builtin_ctz(cand) + 1;
+		cand &= cand - 1;
+		place(row, col, num);
+		SUDOKU_STAT(enterBranch(row * SIZE + col, num));
+		if (backtrack())
+		{
+			return true;
+		}
+		SUDOKU_STAT(leaveBranch());
+		unplace(row, col);
     }
     return false;
 }
 
-// checks if the assignment k to [i][j] is legal or not
-bool Sudoku::isLegal( int i, int j, int num)
+// propagates singles, then branches on the empty cell with the fewest candidates.
+// everything placed below this level is undone before returning false
+template <int N>
+bool BasicSudoku<N>::searchMostConstrained()
 {
-    return row(i, num) && col( j, num) && block(i - i % 3 , j - j % 3, num);
+	nodes++;
+	int mark = trailLen;
+	if (!propagate())
+	{
+		undoTo(mark);
+		return false;
+	}
+
+	int best = mostConstrainedCell();
+	if (best < 0)
+	{
+		return true;
+	}
+
+	int row = Geometry::rowOf(best), col = Geometry::colOf(best);
+	Mask cand = candidates(row, col);
+	while (cand != 0)
+	{
+		int num = __builtin_ctz(cand) + 1;
+		cand &= cand - 1;
+		int branch = trailLen;
+		push(row, col, num);
+		SUDOKU_STAT(enterBranch(best, num));
+		if (searchMostConstrained())
+		{
+			return true;
+		}
+		SUDOKU_STAT(leaveBranch());
+		undoTo(branch);
+	}
+	undoTo(mark);
+	return false;
 }
 
-// checks if there is a 0 left in the puzzle to be solved
-bool Sudoku::SpotLeft(int &row, int &col)
+// searchMostConstrained() branching by copy: the propagated state is saved once
+// per node and copied back after every failed digit, with no trail to walk. a
+// failed search leaves the grid half filled, the caller restores it
+template <int N>
+bool BasicSudoku<N>::searchSnapshot()
+{
+	nodes++;
+	if (!propagate())
+	{
+		return false;
+	}
+
+	int best = mostConstrainedCell();
+	if (best < 0)
+	{
+		return true;
+	}
+
+	// the propagated grid, to come back to after each digit
+	State branch = state;
+	int branchLen = trailLen;
+	int row = Geometry::rowOf(best), col = Geometry::colOf(best);
+	Mask cand = candidates(row, col);
+	while (cand != 0)
+	{
+		int num = __builtin_ctz(cand) + 1;
+		cand &= cand - 1;
+		push(row, col, num);
+		SUDOKU_STAT(enterBranch(best, num));
+		if (searchSnapshot())
+		{
+			return true;
+		}
+		SUDOKU_STAT(leaveBranch());
+		state = branch;
+		trailLen = branchLen;
+	}
+	return false;
+}
+
+// propagateSingles(), timed when statistics are compiled in
+template <int N>
+bool BasicSudoku<N>::propagate()
+{
+#ifdef SUDOKU_STATS
+	double started = secondsNow();
+	int before = trailLen;
+	bool ok = propagateSingles();
+	stats.propagations += trailLen - before;
+	stats.propagateSeconds += secondsNow() - started;
+	return ok;
+#else
+	return propagateSingles();
+#endif
+}
+
+// fills naked singles (one candidate left in a cell) and hidden singles (a digit
+// with one place left in a row, col or block) until nothing changes.
+// returns false if some cell or unit can no longer be completed
+template <int N>
+bool BasicSudoku<N>::propagateSingles()
 {
-    for (row = 0; row < 9; row++)
+	bool changed = true;
+	while (changed)
 	{
-        for (col = 0; col < 9; col++)
+		changed = false;
+
+		// naked singles
+		for (int i = 0; i < SIZE; i++)
 		{
-            if (puz[row][col] == 0)
+			for (int j = 0; j < SIZE; j++)
 			{
-                return true;
+				if (state.puz[i][j] != 0)
+				{
+					continue;
+				}
+				Mask cand = candidates(i, j);
+				if (cand == 0)
+				{
+					return false;
+				}
+				if ((cand & (cand - 1)) == 0)
+				{
+					push(i, j, __builtin_ctz(cand) + 1);
+					changed = true;
+				}
+			}
+		}
+
+		// hidden singles, units are the rows, then the cols, then the blocks
+		for (int unit = 0; unit < UNITS; unit++)
+		{
+			const typename Geometry::Cell *cells = Geometry::unit(unit);
+			Mask used = 0, once = 0, twice = 0;
+			for (int n = 0; n < SIZE; n++)
+			{
+				int i = Geometry::rowOf(cells[n]), j = Geometry::colOf(cells[n]);
+				if (state.puz[i][j] != 0)
+				{
+					used |= Geometry::bitOf(state.puz[i][j]);
+					continue;
+				}
+				Mask cand = candidates(i, j);
+				twice |= once & cand;
+				once |= cand;
+			}
+			if ((used | once) != ALL)
+			{
+				return false;	// some digit has nowhere to go
+			}
+
+			Mask hidden = once & ~twice;
+			for (int n = 0; n < SIZE && hidden != 0; n++)
+			{
+				int i = Geometry::rowOf(cells[n]), j = Geometry::colOf(cells[n]);
+				if (state.puz[i][j] != 0)
+				{
+					continue;
+				}
+				Mask bit = candidates(i, j) & hidden;
+				if (bit == 0)
+				{
+					continue;
+				}
+				if ((bit & (bit - 1)) != 0)
+				{
+					return false;	// two digits need the same cell
+				}
+				push(i, j, __builtin_ctz(bit) + 1);
+				hidden &= ~bit;
+				changed = true;
+			}
+			if (hidden != 0)
+			{
+				return false;	// lost its only cell to an earlier single
 			}
 		}
 	}
-    return false;
+	return true;
 }
 
-
-// See if the value k can be in the row
-bool Sudoku::row(int i, int k)
+// empty cell with the fewest candidates, -1 when the grid is full. stops early at
+// 2 since propagation has already filled every cell with only one
+template <int N>
+int BasicSudoku<N>::mostConstrainedCell() const
 {
-	for (int j = 0; j < 9; j++)
+	int best = -1, bestCount = SIZE + 1;
+	for (int cell = 0; cell < CELLS && bestCount > 2; cell++)
 	{
-		if (puz[i][j] == k)
+		int i = Geometry::rowOf(cell), j = Geometry::colOf(cell);
+		if (state.puz[i][j] == 0)
 		{
-			return false;
+			int count = candidateCount(i, j);
+			if (count < bestCount)
+			{
+				best = cell;
+				bestCount = count;
+			}
 		}
 	}
-	return true;
+	return best;
+}
+
+// the 9x9 board has vector kernels for this, see SudokuKernels.h
+template <>
+int BasicSudoku<3>::mostConstrainedCell() const
+{
+	return sudokuKernels().fewestCandidates(&state.puz[0][0], state.rowMask, state.colMask, state.boxMask);
+}
+
+// places k in [i][j] and remembers it on the trail
+template <int N>
+void BasicSudoku<N>::push(int i, int j, int k)
+{
+	place(i, j, k);
+	trail[trailLen++] = i * SIZE + j;
+}
+
+// takes back every placement made since the trail was at mark
+template <int N>
+void BasicSudoku<N>::undoTo(int mark)
+{
+	while (trailLen > mark)
+	{
+		int cell = trail[--trailLen];
+		unplace(Geometry::rowOf(cell), Geometry::colOf(cell));
+	}
+}
+
+
+// checks if the assignment k to [i][j] is legal or not
+template <int N>
+bool BasicSudoku<N>::isLegal( int i, int j, int num)
+{
+    return (candidates(i, j) & Geometry::bitOf(num)) != 0;
+}
+
+// digits still available for [i][j], one bit per digit
+template <int N>
+typename BasicSudoku<N>::Mask BasicSudoku<N>::candidates(int i, int j) const
+{
+	return ~(state.rowMask[i] | state.colMask[j] | state.boxMask[boxOf(i, j)]) & ALL;
+}
+
+template <int N>
+void BasicSudoku<N>::allCandidates(Mask *out) const
+{
+	for (int cell = 0; cell < CELLS; cell++)
+	{
+		int i = Geometry::rowOf(cell), j = Geometry::colOf(cell);
+		out[cell] = state.puz[i][j] != 0 ? 0 : candidates(i, j);
+	}
+}
+
+template <>
+void BasicSudoku<3>::allCandidates(Mask *out) const
+{
+	sudokuKernels().candidates(&state.puz[0][0], state.rowMask, state.colMask, state.boxMask, out);
+}
+
+// number of digits still available for [i][j]
+template <int N>
+int BasicSudoku<N>::candidateCount(int i, int j) const
+{
+	return __builtin_popcount(candidates(i, j));
+}
+
+// puts k in [i][j] and marks it used in the row, col and block
+template <int N>
+void BasicSudoku<N>::place(int i, int j, int k)
+{
+	Mask bit = Geometry::bitOf(k);
+	state.puz[i][j] = k;
+	state.rowMask[i] |= bit;
+	state.colMask[j] |= bit;
+	state.boxMask[boxOf(i, j)] |= bit;
 }
 
-// See if the value K can be in the col
-bool Sudoku::col(int j, int k)
+// empties [i][j] and frees its digit in the row, col and block
+template <int N>
+void BasicSudoku<N>::unplace(int i, int j)
 {
-	for (int i = 0; i < 9; i++)
+	Mask bit = ~Geometry::bitOf(state.puz[i][j]);
+	state.puz[i][j] = 0;
+	state.rowMask[i] &= bit;
+	state.colMask[j] &= bit;
+	state.boxMask[boxOf(i, j)] &= bit;
+}
+
+// recomputes the masks from scratch, used after the grid is loaded
+template <int N>
+void BasicSudoku<N>::rebuildMasks()
+{
+	countsStale = true;
+	for (int n = 0; n < SIZE; n++)
+	{
+		state.rowMask[n] = state.colMask[n] = state.boxMask[n] = 0;
+	}
+	for (int i = 0; i < SIZE; i++)
 	{
-		if (puz[i][j] == k)
+		for (int j = 0; j < SIZE; j++)
 		{
-			return false;
+			int k = state.puz[i][j];
+			if (k >= 1 && k <= SIZE)
+			{
+				Mask bit = Geometry::bitOf(k);
+				state.rowMask[i] |= bit;
+				state.colMask[j] |= bit;
+				state.boxMask[boxOf(i, j)] |= bit;
+			}
 		}
 	}
-	return true;
 }
 
-// See if the value K can be in the block
-bool Sudoku::block(int i, int j, int k)
+// checks if there is a 0 left in the puzzle to be solved
+template <int N>
+bool BasicSudoku<N>::SpotLeft(int &row, int &col)
 {
-	for (int row = 0; row < 3; row++)
+    for (row = 0; row < SIZE; row++)
 	{
-		for (int col = 0; col <3; col++)
+        for (col = 0; col < SIZE; col++)
 		{
-			if (puz[row+i][col+j] == k)
+            if (state.puz[row][col] == 0)
 			{
-				return false;
+                return true;
 			}
 		}
 	}
-	return true;
+    return false;
+}
+
+
+
+
+
+// clears the counters and marks the start of a search in the trace
+template <int N>
+void BasicSudoku<N>::startStats()
+{
+	stats.reset();
+	level = 0;
+	if (trace != NULL)
+	{
+		trace->puzzle();
+	}
+}
 
+// adds the time since startTime, and ends the search in the trace unless it can
+// still be resumed
+template <int N>
+void BasicSudoku<N>::finishStats(Status status, double startTime)
+{
+	stats.nodes = nodes;
+	stats.totalSeconds += secondsNow() - startTime;
+	if (trace != NULL && status != BUDGET_EXHAUSTED)
+	{
+		trace->result(status == SOLVED);
+	}
 }
 
+// a digit is being tried at cell, one level below the current one
+template <int N>
+void BasicSudoku<N>::enterBranch(int cell, int digit)
+{
+	level++;
+	if (level > stats.maxDepth)
+	{
+		stats.maxDepth = level;
+	}
+	if (trace != NULL)
+	{
+		trace->branch(level, cell, digit);
+	}
+}
+
+// the digit tried at the current level is being taken back
+template <int N>
+void BasicSudoku<N>::leaveBranch()
+{
+	stats.backtracks++;
+	if (trace != NULL)
+	{
+		trace->undo(level);
+	}
+	level--;
+}
 
+// counters of the last search, all zero unless built with SUDOKU_STATS
+template <int N>
+const SudokuStats &BasicSudoku<N>::statistics() const
+{
+	return stats;
+}
 
+// records the branching decisions of every following search to t, NULL to stop.
+// only has an effect when built with SUDOKU_STATS
+template <int N>
+void BasicSudoku<N>::setTrace(SudokuTrace *t)
+{
+	trace = t;
+}
 
+// search nodes entered by the last solve(), solveWithin() (together with any
+// resume() calls after it) or single threaded countSolutions()
+template <int N>
+long BasicSudoku<N>::nodeCount() const
+{
+	return nodes;
+}
 
-void Sudoku::print() const
+template <int N>
+size_t BasicSudoku<N>::format(char *out, Format f) const
 {
-	for (int i = 0; i < 9; i++)
+	if (f == LINE)
 	{
-		if (i == 3 || i == 6)
+		toLine(out);
+		out[CELLS] = '\n';
+		return CELLS + 1;
+	}
+	if (f == PACKED)
+	{
+		toPacked((unsigned char *)out);
+		return PACKED_BYTES;
+	}
+
+	// each cell takes width + 1 characters, so the 9x9 layout is unchanged
+	const int width = SIZE > 9 ? 2 : 1;
+	char *next = out;
+	for (int i = 0; i < SIZE; i++)
+	{
+		if (i != 0 && i % N == 0)
 		{
-			cout << "------+-------+------" << endl;
+			// dashes under every cell, a + under each "| " of the rows
+			for (int b = 0; b < N; b++)
+			{
+				if (b != 0)
+				{
+					*next++ = '+';
+				}
+				int dashes = N * (width + 1) + (b != 0 && b != N - 1);
+				memset(next, '-', dashes);
+				next += dashes;
+			}
+			*next++ = '\n';
 		}
-		for (int j = 0; j < 9; j++)
+		for (int j = 0; j < SIZE; j++)
 		{
-			if (j == 3 || j == 6)
+			if (j != 0 && j % N == 0)
+			{
+				*next++ = '|';
+				*next++ = ' ';
+			}
+			int k = state.puz[i][j];
+			if (k >= 10)
 			{
-				cout << "| ";
+				*next++ = '0' + k / 10;
 			}
-			cout << puz[i][j] << " ";
+			else if (width == 2)
+			{
+				*next++ = ' ';
+			}
+			*next++ = '0' + k % 10;
+			*next++ = ' ';
 		}
-		cout << endl;
+		*next++ = '\n';
+	}
+	return next - out;
+}
 
+// the PRETTY layout on cout
+template <int N>
+void BasicSudoku<N>::print() const
+{
+	char text[FORMAT_BYTES];
+	cout.write(text, format(text, PRETTY));
+	cout.flush();
+}
+
+template <int N>
+bool BasicSudoku<N>::equals(const BasicSudoku &other) const
+{
+	return memcmp(state.puz, other.state.puz, sizeof(state.puz)) == 0;
+}
 
+// checked from the digits alone, the masks of a bad grid can look complete
+template <int N>
+bool BasicSudoku<N>::isSolved() const
+{
+	Mask rows[SIZE] = { 0 }, cols[SIZE] = { 0 }, boxes[SIZE] = { 0 };
+	for (int i = 0; i < SIZE; i++)
+	{
+		for (int j = 0; j < SIZE; j++)
+		{
+			int k = state.puz[i][j];
+			if (k < 1 || k > SIZE)
+			{
+				return false;
+			}
+			rows[i] |= Geometry::bitOf(k);
+			cols[j] |= Geometry::bitOf(k);
+			boxes[boxOf(i, j)] |= Geometry::bitOf(k);
+		}
 	}
+	// SIZE cells can only hold every digit by holding each once
+	for (int n = 0; n < SIZE; n++)
+	{
+		if (rows[n] != ALL || cols[n] != ALL || boxes[n] != ALL)
+		{
+			return false;
+		}
+	}
+	return true;
+}
 
+template <>
+bool BasicSudoku<3>::isSolved() const
+{
+	return sudokuKernels().validGrid(&state.puz[0][0]);
 }
 
-bool Sudoku::equals(const Sudoku &other) const
+// counts the digits of every unit again after the grid changed behind our back
+template <int N>
+void BasicSudoku<N>::syncCounts() const
 {
-	for (int i = 0; i < 9; i++)
+	if (!countsStale)
+	{
+		return;
+	}
+	memset(unitCount, 0, sizeof(unitCount));
+	conflictPairs = disagreeing = 0;
+	for (int i = 0; i < SIZE; i++)
 	{
-		for (int j = 0; j<9; j++)
+		for (int j = 0; j < SIZE; j++)
 		{
-			if (puz[i][j] != other.puz[i][j])
+			int k = state.puz[i][j];
+			if (k == 0)
 			{
-				return false;
+				continue;
 			}
+			int units[3] = { i, SIZE + j, 2 * SIZE + boxOf(i, j) };
+			for (int u = 0; u < 3; u++)
+			{
+				if (++unitCount[units[u]][k - 1] == 2)
+				{
+					conflictPairs++;
+				}
+			}
+			if (haveKnown && known[i * SIZE + j] != k)
+			{
+				disagreeing++;
+			}
+		}
+	}
+	countsStale = false;
+}
 
+// adds (delta 1) or takes away (delta -1) the digit k at [i][j] in the counts
+// of its three units. a mask bit is only cleared with the last copy of its digit
+template <int N>
+void BasicSudoku<N>::recount(int i, int j, int k, int delta)
+{
+	int units[3] = { i, SIZE + j, 2 * SIZE + boxOf(i, j) };
+	Mask *masks[3] = { &state.rowMask[i], &state.colMask[j], &state.boxMask[boxOf(i, j)] };
+	Mask bit = Geometry::bitOf(k);
+	for (int u = 0; u < 3; u++)
+	{
+		unsigned char &count = unitCount[units[u]][k - 1];
+		if (delta > 0)
+		{
+			if (++count == 2)
+			{
+				conflictPairs++;
+			}
+			*masks[u] |= bit;
 		}
+		else
+		{
+			if (count-- == 2)
+			{
+				conflictPairs--;
+			}
+			if (count == 0)
+			{
+				*masks[u] &= ~bit;
+			}
+		}
+	}
+	if (haveKnown && known[i * SIZE + j] != k)
+	{
+		disagreeing += delta;
+	}
+}
+
+template <int N>
+int BasicSudoku<N>::setCell(int i, int j, int k)
+{
+	if (i < 0 || i >= SIZE || j < 0 || j >= SIZE || k < 1 || k > SIZE)
+	{
+		return -1;
+	}
+	syncCounts();
+	if (state.puz[i][j] != 0)
+	{
+		recount(i, j, state.puz[i][j], -1);
+	}
+	state.puz[i][j] = k;
+	recount(i, j, k, 1);
+	suspended = false;
+	return conflictPairs;
+}
+
+template <int N>
+int BasicSudoku<N>::clearCell(int i, int j)
+{
+	if (i < 0 || i >= SIZE || j < 0 || j >= SIZE)
+	{
+		return -1;
+	}
+	syncCounts();
+	if (state.puz[i][j] != 0)
+	{
+		recount(i, j, state.puz[i][j], -1);
+		state.puz[i][j] = 0;
+	}
+	suspended = false;
+	return conflictPairs;
+}
+
+template <int N>
+int BasicSudoku<N>::conflicts() const
+{
+	syncCounts();
+	return conflictPairs;
+}
+
+template <int N>
+bool BasicSudoku<N>::isConflicting(int i, int j) const
+{
+	int k = state.puz[i][j];
+	if (k == 0)
+	{
+		return false;
+	}
+	syncCounts();
+	return unitCount[i][k - 1] > 1 || unitCount[SIZE + j][k - 1] > 1 ||
+		unitCount[2 * SIZE + boxOf(i, j)][k - 1] > 1;
+}
+
+template <int N>
+typename BasicSudoku<N>::Mask BasicSudoku<N>::cellCandidates(int i, int j) const
+{
+	return candidates(i, j);
+}
+
+// solves a copy of the grid into known. the masks cannot see a digit twice in a
+// unit, so callers rule out conflicts first
+template <int N>
+bool BasicSudoku<N>::findKnown()
+{
+	State saved = state;
+	haveKnown = solveWithin(Budget()) == SOLVED;
+	if (haveKnown)
+	{
+		memcpy(known, state.puz, sizeof(known));
+	}
+	// the grid is back to what the counts describe, and agrees with known
+	state = saved;
+	suspended = false;
+	countsStale = false;
+	disagreeing = 0;
+	return haveKnown;
+}
 
+template <int N>
+bool BasicSudoku<N>::hint(int &i, int &j, int &k)
+{
+	if (!isStillSolvable())
+	{
+		return false;
 	}
+	int cell = mostConstrainedCell();
+	if (cell < 0)
+	{
+		return false;
+	}
+	i = Geometry::rowOf(cell);
+	j = Geometry::colOf(cell);
+	k = known[cell];
 	return true;
+}
 
+template <int N>
+bool BasicSudoku<N>::isStillSolvable()
+{
+	syncCounts();
+	if (conflictPairs > 0)
+	{
+		return false;
+	}
+	return (haveKnown && disagreeing == 0) || findKnown();
+}
 
-}
\ No newline at end of file
+template class BasicSudoku<2>;
+template class BasicSudoku<3>;
+template class BasicSudoku<4>;
+template class BasicSudoku<5>;
@@ -1,26 +1,210 @@
 
+#ifndef __SUDOKU_
+#define __SUDOKU_
+
+#include <atomic>
 #include <iostream>
 #include <string>
+#include "SudokuGeometry.h"
+#include "SudokuStats.h"
 using namespace std;
 
-class Sudoku
+class ThreadPool;
+
+
+// options and results shared by every board size
+class SudokuBase
+{
+public:
+	// how solve() picks the next cell to branch on
+	enum SearchMode
+	{
+		FIRST_EMPTY,		// first empty cell in row-major order
+		MOST_CONSTRAINED,	// fewest candidates, with singles propagated first
+		SNAPSHOT			// same search, but a branch copies the board state and
+							// restores the copy instead of undoing placements
+	};
+
+	// which solver solve() runs
+	enum Engine
+	{
+		BACKTRACKING,		// recursive search, see SearchMode
+		DANCING_LINKS		// exact cover with Algorithm X
+	};
+
+	// outcome of solveWithin() and resume()
+	enum Status
+	{
+		SOLVED,
+		NO_SOLUTION,
+		BUDGET_EXHAUSTED	// stopped early, resume() carries on from the same node
+	};
+
+	// layouts format() renders a grid in
+	enum Format
+	{
+		PRETTY,			// the boxed layout of print(), one row per line
+		LINE,			// CELLS characters and a newline, as read by loadFromLine()
+		PACKED			// the bytes of toPacked()
+	};
+
+	// limits for one solveWithin() or resume() call, 0 or NULL means no limit
+	struct Budget
+	{
+		long nodes;
+		long microseconds;
+		const atomic<bool> *cancel;		// another thread sets this to stop the search
+
+		Budget() : nodes(0), microseconds(0), cancel(NULL) {}
+	};
+};
+
+// A board with N x N boxes, so SIZE = N*N digits and rows. Every bound below is a
+// compile time constant, so the loops of each size are unrolled separately and
+// the 9x9 board pays nothing for the bigger ones.
+template <int N>
+class BasicSudoku : public SudokuBase
 {
+public:
+	typedef typename SudokuMask<N>::type Mask;
+
+	static constexpr int BOX = N;
+	static constexpr int SIZE = N * N;
+	static constexpr int CELLS = SIZE * SIZE;
+	static constexpr int UNITS = 3 * SIZE;		// rows, then cols, then boxes
+	static constexpr Mask ALL = (Mask)((1ull << SIZE) - 1);
+	// toPacked() size: two cells per byte while digits fit in 4 bits, else one
+	static constexpr int PACKED_BYTES = SIZE < 16 ? (CELLS + 1) / 2 : CELLS;
+	// most bytes format() writes: lines of up to 3 characters a cell, 2 per box
+	// border and a newline, one per row and box rule
+	static constexpr int FORMAT_BYTES = (SIZE + N) * (SIZE * (SIZE > 9 ? 3 : 2) + 2 * N + 1);
+
 private:
-	int puz[9][9];
+	// everything placing a digit changes: 135 bytes for 9x9 instead of the 378 of
+	// an int grid, so a copy is cheap enough to branch on
+	struct State
+	{
+		unsigned char puz[SIZE][SIZE];	// 0 for an empty cell
+		// occupancy masks, bit k-1 is set when the digit k is used in that row/col/box
+		Mask rowMask[SIZE];
+		Mask colMask[SIZE];
+		Mask boxMask[SIZE];
+	};
+	State state;
+	typedef SudokuGeometry<N> Geometry;
+	static int boxOf(int i, int j) { return Geometry::boxOf(i * SIZE + j); }
 	bool SpotLeft(int &i, int &j);
-	bool row(int i, int k);
-	bool col(int j, int k);
-	bool block(int i, int j, int k);
 	bool isLegal(int i, int j, int k);
+	Mask candidates(int i, int j) const;
+	void place(int i, int j, int k);
+	void unplace(int i, int j);
+	void rebuildMasks();
+	// cells placed by the MOST_CONSTRAINED search, so they can be undone on backtrack
+	int trail[CELLS];
+	int trailLen;
+	SearchMode mode;
+	Engine engine;
+	bool backtrack();
+	bool searchMostConstrained();
+	bool searchSnapshot();
+	bool propagate();
+	int mostConstrainedCell() const;
+	void push(int i, int j, int k);
+	void undoTo(int mark);
+	// explicit stack for solveWithin(), one frame per branching cell
+	struct Frame
+	{
+		int cell;
+		Mask untried;		// candidates not tried yet
+		int mark;			// trail length when the node was entered
+		int base;			// trail length after propagation
+	};
+	Frame frames[CELLS];
+	int depth;
+	bool suspended;				// a search ran out of budget and can be resumed
+	Status runSearch(const Budget &budget);
+	long nodes;					// search nodes entered by the last search
+	// instrumentation, only updated when built with SUDOKU_STATS
+	SudokuStats stats;
+	SudokuTrace *trace;
+	int level;					// branching depth of the recursive searches
+	void startStats();
+	void finishStats(Status status, double startTime);
+	void enterBranch(int cell, int digit);
+	void leaveBranch();
+	bool propagateSingles();
+	void countFrom(long limit, atomic<long> &found);
+	void countSplit(long limit, int splitDepth, atomic<long> &found, ThreadPool &pool);
+	// interactive editing, see setCell(). how many cells of each unit hold each
+	// digit, so a digit stays in the masks until its last copy is cleared. rebuilt
+	// on first use after a load or a search has changed the grid
+	mutable unsigned char unitCount[UNITS][SIZE];
+	mutable int conflictPairs;		// (unit, digit) pairs held by more than one cell
+	mutable int disagreeing;		// filled cells that differ from known
+	mutable bool countsStale;
+	// the last solution found by hint() or isStillSolvable(). while every filled
+	// cell agrees with it, it still solves the grid and no search is needed
+	unsigned char known[CELLS];
+	bool haveKnown;
+	void syncCounts() const;
+	void recount(int i, int j, int k, int delta);
+	bool findKnown();
 
 
 public:
-	Sudoku();
-	void loadFromFile (string filename);
+	BasicSudoku();
+	bool loadFromFile (string filename);
+	bool loadFromBuffer(const char *data, size_t length, size_t *consumed = NULL);
+	bool loadFromLine(const char *line, int length);
+	void toLine(char *out) const;
+	bool loadFromPacked(const unsigned char *in);
+	void toPacked(unsigned char *out) const;
 	bool solve();
+	void setSearchMode(SearchMode m);
+	void setEngine(Engine e);
+	Status solveWithin(const Budget &budget);
+	Status resume(const Budget &budget);
+	long countSolutions(long limit);
+	long countSolutions(long limit, ThreadPool &pool);
+	// renders the grid into out, which has room for FORMAT_BYTES, and returns the
+	// number of bytes written. no terminator
+	size_t format(char *out, Format f) const;
 	void print() const;
-	bool equals(const Sudoku &other) const;
+	bool equals(const BasicSudoku &other) const;
+	// true if every row, col and box holds each digit exactly once
+	bool isSolved() const;
+	int candidateCount(int i, int j) const;
+	// candidates of every cell, 0 for a filled one. out needs room for CELLS + 15
+	void allCandidates(Mask *out) const;
+
+	// interactive editing: each call updates the cell's row, col and box in O(1)
+	// and returns the number of conflicts left, the (unit, digit) pairs held by
+	// more than one cell. -1 if the cell or digit is out of range
+	int setCell(int i, int j, int k);
+	int clearCell(int i, int j);
+	int conflicts() const;
+	// true if the digit in [i][j] is also in its row, col or box
+	bool isConflicting(int i, int j) const;
+	// digits still allowed in [i][j] by the filled cells around it
+	Mask cellCandidates(int i, int j) const;
+	// an empty cell and the digit it takes in a solution of the current grid,
+	// preferring cells with the fewest candidates. false if the grid is full,
+	// has conflicts or cannot be solved
+	bool hint(int &i, int &j, int &k);
+	// false if the grid has conflicts or no solution. both searches run only when
+	// the last solution found no longer fits the filled cells
+	bool isStillSolvable();
+	long nodeCount() const;
+	const SudokuStats &statistics() const;
+	void setTrace(SudokuTrace *t);
+
+
+
+};
 
+typedef BasicSudoku<3> Sudoku;
+typedef BasicSudoku<2> Sudoku4x4;
+typedef BasicSudoku<4> Sudoku16x16;
+typedef BasicSudoku<5> Sudoku25x25;
 
-	
-};
\ No newline at end of file
+#endif /* __SUDOKU_ */
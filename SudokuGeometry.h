@@ -0,0 +1,127 @@
+// Board geometry of the N x N box board as compile time tables.
+//
+// For every cell its row, col and box, for every unit (rows, then cols, then
+// boxes) its SIZE cells, for every cell its peers (the cells sharing a unit with
+// it: its row, then its col, then the rest of its box), and the mask bit of every
+// digit. The compiler builds them from the formulas below, so the solvers look
+// the geometry up instead of dividing by SIZE and N in their inner loops, and
+// every engine reads the same few kilobytes of read-only data.
+
+#ifndef __SUDOKU_GEOMETRY_
+#define __SUDOKU_GEOMETRY_
+
+#include <type_traits>
+
+// smallest unsigned type with one bit per digit of a board with box order N
+template <int N> struct SudokuMask;
+template <> struct SudokuMask<2> { typedef unsigned char type; };	// 4 digits
+template <> struct SudokuMask<3> { typedef unsigned short type; };	// 9 digits
+template <> struct SudokuMask<4> { typedef unsigned short type; };	// 16 digits
+template <> struct SudokuMask<5> { typedef unsigned int type; };	// 25 digits
+
+// 0, 1, ... LENGTH - 1 as a parameter pack. built by halves, so the template
+// depth stays logarithmic even for the 25x25 peer table
+template <int... I> struct IndexList {};
+
+template <class A, class B> struct JoinIndexLists;
+template <int... I, int... J> struct JoinIndexLists<IndexList<I...>, IndexList<J...> >
+{
+	typedef IndexList<I..., ((int)sizeof...(I) + J)...> type;
+};
+
+template <int LENGTH> struct MakeIndexList
+{
+	typedef typename JoinIndexLists<typename MakeIndexList<LENGTH / 2>::type,
+		typename MakeIndexList<LENGTH - LENGTH / 2>::type>::type type;
+};
+template <> struct MakeIndexList<0> { typedef IndexList<> type; };
+template <> struct MakeIndexList<1> { typedef IndexList<0> type; };
+
+// an array holding ENTRY(0) ... ENTRY(LENGTH - 1)
+template <typename T, int LENGTH, T (*ENTRY)(int), class List = typename MakeIndexList<LENGTH>::type>
+struct ConstTable;
+template <typename T, int LENGTH, T (*ENTRY)(int), int... I>
+struct ConstTable<T, LENGTH, ENTRY, IndexList<I...> >
+{
+	static constexpr T at[LENGTH] = { ENTRY(I)... };
+};
+template <typename T, int LENGTH, T (*ENTRY)(int), int... I>
+constexpr T ConstTable<T, LENGTH, ENTRY, IndexList<I...> >::at[LENGTH];
+
+// the formulas the tables are built from, one expression each for C++11
+template <int N>
+struct SudokuLayout
+{
+	static constexpr int SIZE = N * N;
+	static constexpr int CELLS = SIZE * SIZE;
+	static constexpr int UNITS = 3 * SIZE;
+	static constexpr int PEERS = 2 * (SIZE - 1) + (N - 1) * (N - 1);
+	typedef typename SudokuMask<N>::type Mask;
+	// cell numbers, one byte up to 16x16
+	typedef typename std::conditional<(CELLS <= 256), unsigned char, unsigned short>::type Cell;
+
+	static constexpr unsigned char row(int cell) { return cell / SIZE; }
+	static constexpr unsigned char col(int cell) { return cell % SIZE; }
+	static constexpr unsigned char box(int cell) { return cell / SIZE / N * N + cell % SIZE / N; }
+
+	// cell n of box b
+	static constexpr Cell boxCell(int b, int n)
+	{
+		return (b / N * N + n / N) * SIZE + b % N * N + n % N;
+	}
+	// entry u * SIZE + n is cell n of unit u
+	static constexpr Cell unitCell(int entry)
+	{
+		return entry / SIZE < SIZE ? entry :
+			entry / SIZE < 2 * SIZE ? entry % SIZE * SIZE + (entry / SIZE - SIZE) :
+			boxCell(entry / SIZE - 2 * SIZE, entry % SIZE);
+	}
+
+	// the m-th of 0, 1, ... without self
+	static constexpr int other(int m, int self) { return m < self ? m : m + 1; }
+	// peer k of cell i * SIZE + j: SIZE - 1 in the row, SIZE - 1 in the col, then
+	// the (N - 1)^2 cells of the box on neither
+	static constexpr Cell rowPeer(int i, int j, int k) { return i * SIZE + other(k, j); }
+	static constexpr Cell colPeer(int i, int j, int k) { return other(k, i) * SIZE + j; }
+	static constexpr Cell boxPeer(int i, int j, int k)
+	{
+		return (i - i % N + other(k / (N - 1), i % N)) * SIZE + j - j % N + other(k % (N - 1), j % N);
+	}
+	// entry cell * PEERS + k is peer k of cell
+	static constexpr Cell peer(int entry)
+	{
+		return entry % PEERS < SIZE - 1 ? rowPeer(entry / PEERS / SIZE, entry / PEERS % SIZE, entry % PEERS) :
+			entry % PEERS < 2 * (SIZE - 1) ?
+				colPeer(entry / PEERS / SIZE, entry / PEERS % SIZE, entry % PEERS - (SIZE - 1)) :
+				boxPeer(entry / PEERS / SIZE, entry / PEERS % SIZE, entry % PEERS - 2 * (SIZE - 1));
+	}
+
+	// the mask bit of digit k, none for 0
+	static constexpr Mask bit(int k) { return k == 0 ? 0 : (Mask)1 << (k - 1); }
+};
+
+template <int N>
+struct SudokuGeometry : SudokuLayout<N>
+{
+	typedef SudokuLayout<N> L;
+	typedef typename L::Mask Mask;
+	typedef typename L::Cell Cell;
+
+	typedef ConstTable<unsigned char, L::CELLS, &L::row> RowTable;
+	typedef ConstTable<unsigned char, L::CELLS, &L::col> ColTable;
+	typedef ConstTable<unsigned char, L::CELLS, &L::box> BoxTable;
+	typedef ConstTable<Cell, L::UNITS * L::SIZE, &L::unitCell> UnitTable;
+	typedef ConstTable<Cell, L::CELLS * L::PEERS, &L::peer> PeerTable;
+	typedef ConstTable<Mask, L::SIZE + 1, &L::bit> BitTable;
+
+	static int rowOf(int cell) { return RowTable::at[cell]; }
+	static int colOf(int cell) { return ColTable::at[cell]; }
+	static int boxOf(int cell) { return BoxTable::at[cell]; }
+	// the SIZE cells of unit u
+	static const Cell *unit(int u) { return &UnitTable::at[u * L::SIZE]; }
+	// the PEERS cells sharing a unit with cell
+	static const Cell *peers(int cell) { return &PeerTable::at[cell * L::PEERS]; }
+	static Mask bitOf(int k) { return BitTable::at[k]; }
+};
+
+#endif /* __SUDOKU_GEOMETRY_ */
@@ -0,0 +1,314 @@
+#include <cstdlib>
+#include <cstring>
+#include "SudokuKernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SUDOKU_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+const unsigned short ALL_DIGITS = 0x1FF;
+
+static void candidatesScalar(const unsigned char *cells, const unsigned short *rowMask,
+	const unsigned short *colMask, const unsigned short *boxMask, unsigned short *out)
+{
+	for (int cell = 0; cell < 81; cell++)
+	{
+		int i = cell / 9, j = cell % 9;
+		out[cell] = cells[cell] != 0 ? 0 : ~(rowMask[i] | colMask[j] | boxMask[i / 3 * 3 + j / 3]) & ALL_DIGITS;
+	}
+}
+
+static int fewestCandidatesScalar(const unsigned char *cells, const unsigned short *rowMask,
+	const unsigned short *colMask, const unsigned short *boxMask)
+{
+	int best = -1, bestCount = 10;
+	for (int cell = 0; cell < 81 && bestCount > 2; cell++)
+	{
+		if (cells[cell] == 0)
+		{
+			int i = cell / 9, j = cell % 9;
+			int count = __builtin_popcount(~(rowMask[i] | colMask[j] | boxMask[i / 3 * 3 + j / 3]) & ALL_DIGITS);
+			if (count < bestCount)
+			{
+				best = cell;
+				bestCount = count;
+			}
+		}
+	}
+	return best;
+}
+
+static bool validGridScalar(const unsigned char *cells)
+{
+	unsigned short rows[9] = { 0 }, cols[9] = { 0 }, boxes[9] = { 0 };
+	for (int cell = 0; cell < 81; cell++)
+	{
+		int k = cells[cell];
+		if (k < 1 || k > 9)
+		{
+			return false;
+		}
+		int i = cell / 9, j = cell % 9;
+		rows[i] |= 1 << (k - 1);
+		cols[j] |= 1 << (k - 1);
+		boxes[i / 3 * 3 + j / 3] |= 1 << (k - 1);
+	}
+	// 9 cells can only cover all 9 digits by holding each once
+	for (int n = 0; n < 9; n++)
+	{
+		if (rows[n] != ALL_DIGITS || cols[n] != ALL_DIGITS || boxes[n] != ALL_DIGITS)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef SUDOKU_X86_KERNELS
+
+// The grid is copied into a 96 byte buffer first so the 16 byte loads of the last
+// row stay inside it. A row of 9 cells then takes 8 lanes of a 128-bit register
+// plus one scalar (SSE), or 9 of the 16 lanes of a 256-bit one (AVX2).
+
+// number of set bits in each 16-bit lane
+__attribute__((target("sse4.2")))
+static inline __m128i popcount16(__m128i v)
+{
+	const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	__m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(table, _mm_and_si128(v, nibble)),
+		_mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+	return _mm_add_epi16(_mm_and_si128(bytes, _mm_set1_epi16(0xFF)), _mm_srli_epi16(bytes, 8));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i popcount16(__m256i v)
+{
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	__m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble)),
+		_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+	return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xFF)), _mm256_srli_epi16(bytes, 8));
+}
+
+// first cell of the 96 counts with the lowest one, -1 if all are 0xFFFF
+__attribute__((target("sse4.2")))
+static int firstLowest(const unsigned short *counts)
+{
+	int best = -1, bestCount = 0xFFFF;
+	for (int n = 0; n < 96; n += 8)
+	{
+		// lowest count in bits 0-15, its lane in bits 16-18
+		int found = _mm_cvtsi128_si32(_mm_minpos_epu16(_mm_loadu_si128((const __m128i *)&counts[n])));
+		if ((found & 0xFFFF) < bestCount)
+		{
+			bestCount = found & 0xFFFF;
+			best = n + (found >> 16);
+		}
+	}
+	return best;
+}
+
+__attribute__((target("sse4.2")))
+static void candidatesSse(const unsigned char *cells, const unsigned short *rowMask,
+	const unsigned short *colMask, const unsigned short *boxMask, unsigned short *out)
+{
+	unsigned char grid[96] = { 0 };
+	memcpy(grid, cells, 81);
+	const __m128i all = _mm_set1_epi16(ALL_DIGITS);
+	__m128i cols = _mm_loadu_si128((const __m128i *)colMask);
+	for (int band = 0; band < 3; band++)
+	{
+		int b0 = boxMask[band * 3], b1 = boxMask[band * 3 + 1], b2 = boxMask[band * 3 + 2];
+		__m128i units = _mm_or_si128(cols, _mm_setr_epi16(b0, b0, b0, b1, b1, b1, b2, b2));
+		for (int r = band * 3; r < band * 3 + 3; r++)
+		{
+			__m128i cand = _mm_andnot_si128(_mm_or_si128(units, _mm_set1_epi16(rowMask[r])), all);
+			__m128i empty = _mm_cmpeq_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&grid[r * 9])),
+				_mm_setzero_si128());
+			_mm_storeu_si128((__m128i *)&out[r * 9], _mm_and_si128(cand, empty));
+			out[r * 9 + 8] = grid[r * 9 + 8] != 0 ? 0 : ~(rowMask[r] | colMask[8] | b2) & ALL_DIGITS;
+		}
+	}
+}
+
+__attribute__((target("sse4.2")))
+static int fewestCandidatesSse(const unsigned char *cells, const unsigned short *rowMask,
+	const unsigned short *colMask, const unsigned short *boxMask)
+{
+	unsigned char grid[96] = { 0 };
+	memcpy(grid, cells, 81);
+	unsigned short counts[96];
+	const __m128i all = _mm_set1_epi16(ALL_DIGITS), two = _mm_set1_epi16(2);
+	__m128i cols = _mm_loadu_si128((const __m128i *)colMask);
+	for (int band = 0; band < 3; band++)
+	{
+		int b0 = boxMask[band * 3], b1 = boxMask[band * 3 + 1], b2 = boxMask[band * 3 + 2];
+		__m128i units = _mm_or_si128(cols, _mm_setr_epi16(b0, b0, b0, b1, b1, b1, b2, b2));
+		for (int r = band * 3; r < band * 3 + 3; r++)
+		{
+			__m128i cand = _mm_andnot_si128(_mm_or_si128(units, _mm_set1_epi16(rowMask[r])), all);
+			__m128i empty = _mm_cmpeq_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&grid[r * 9])),
+				_mm_setzero_si128());
+			// counts of 2 or less all become 2, so the first of them wins; filled
+			// cells never do
+			__m128i count = _mm_max_epu16(popcount16(cand), two);
+			count = _mm_or_si128(count, _mm_andnot_si128(empty, _mm_set1_epi16(-1)));
+			_mm_storeu_si128((__m128i *)&counts[r * 9], count);
+			int last = __builtin_popcount(~(rowMask[r] | colMask[8] | b2) & ALL_DIGITS);
+			counts[r * 9 + 8] = grid[r * 9 + 8] != 0 ? 0xFFFF : last > 2 ? last : 2;
+		}
+	}
+	for (int n = 81; n < 96; n++)
+	{
+		counts[n] = 0xFFFF;
+	}
+	return firstLowest(counts);
+}
+
+__attribute__((target("avx2")))
+static void candidatesAvx2(const unsigned char *cells, const unsigned short *rowMask,
+	const unsigned short *colMask, const unsigned short *boxMask, unsigned short *out)
+{
+	unsigned char grid[96] = { 0 };
+	unsigned short col[16] = { 0 };
+	memcpy(grid, cells, 81);
+	memcpy(col, colMask, 9 * sizeof(unsigned short));
+	const __m256i all = _mm256_set1_epi16(ALL_DIGITS);
+	__m256i cols = _mm256_loadu_si256((const __m256i *)col);
+	for (int band = 0; band < 3; band++)
+	{
+		short b0 = boxMask[band * 3], b1 = boxMask[band * 3 + 1], b2 = boxMask[band * 3 + 2];
+		__m256i units = _mm256_or_si256(cols, _mm256_setr_epi16(b0, b0, b0, b1, b1, b1, b2, b2, b2, 0, 0, 0, 0, 0, 0, 0));
+		for (int r = band * 3; r < band * 3 + 3; r++)
+		{
+			__m256i cand = _mm256_andnot_si256(_mm256_or_si256(units, _mm256_set1_epi16(rowMask[r])), all);
+			__m256i empty = _mm256_cmpeq_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&grid[r * 9])),
+				_mm256_setzero_si256());
+			// lanes 9-15 spill into the next row, which overwrites them
+			_mm256_storeu_si256((__m256i *)&out[r * 9], _mm256_and_si256(cand, empty));
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static int fewestCandidatesAvx2(const unsigned char *cells, const unsigned short *rowMask,
+	const unsigned short *colMask, const unsigned short *boxMask)
+{
+	unsigned char grid[96] = { 0 };
+	unsigned short col[16] = { 0 };
+	unsigned short counts[96 + 16];
+	memcpy(grid, cells, 81);
+	memcpy(col, colMask, 9 * sizeof(unsigned short));
+	const __m256i all = _mm256_set1_epi16(ALL_DIGITS), two = _mm256_set1_epi16(2);
+	__m256i cols = _mm256_loadu_si256((const __m256i *)col);
+	for (int band = 0; band < 3; band++)
+	{
+		short b0 = boxMask[band * 3], b1 = boxMask[band * 3 + 1], b2 = boxMask[band * 3 + 2];
+		__m256i units = _mm256_or_si256(cols, _mm256_setr_epi16(b0, b0, b0, b1, b1, b1, b2, b2, b2, 0, 0, 0, 0, 0, 0, 0));
+		for (int r = band * 3; r < band * 3 + 3; r++)
+		{
+			__m256i cand = _mm256_andnot_si256(_mm256_or_si256(units, _mm256_set1_epi16(rowMask[r])), all);
+			__m256i empty = _mm256_cmpeq_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&grid[r * 9])),
+				_mm256_setzero_si256());
+			__m256i count = _mm256_max_epu16(popcount16(cand), two);
+			count = _mm256_or_si256(count, _mm256_andnot_si256(empty, _mm256_set1_epi16(-1)));
+			_mm256_storeu_si256((__m256i *)&counts[r * 9], count);
+		}
+	}
+	for (int n = 81; n < 96; n++)
+	{
+		counts[n] = 0xFFFF;
+	}
+	return firstLowest(counts);
+}
+
+// A 9 cell row fits one 128-bit register, so the AVX2 set uses this one too
+__attribute__((target("sse4.2")))
+static bool validGridSse(const unsigned char *cells)
+{
+	unsigned char grid[96] = { 0 };
+	memcpy(grid, cells, 81);
+	// the bit of digit k split into a low byte (1..8) and a high byte (9). cells
+	// other than 1..9 get no bit, so their unit comes up short
+	const __m128i lowBit = _mm_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i highBit = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0);
+	const __m128i outside = _mm_set1_epi8(15);
+	__m128i columns = _mm_setzero_si128(), band = _mm_setzero_si128();
+	int column8 = 0, band8 = 0;
+	for (int r = 0; r < 9; r++)
+	{
+		// the shuffle only looks at the low 4 bits, so map larger cells to 15
+		__m128i digits = _mm_min_epu8(_mm_loadu_si128((const __m128i *)&grid[r * 9]), outside);
+		__m128i low = _mm_shuffle_epi8(lowBit, digits), high = _mm_shuffle_epi8(highBit, digits);
+		__m128i bits = _mm_unpacklo_epi8(low, high);		// cells 0..7, a 16-bit lane each
+		int bit8 = _mm_extract_epi16(_mm_unpackhi_epi8(low, high), 0);
+
+		// 9 cells can only cover all 9 digits by holding each once
+		__m128i row = _mm_or_si128(bits, _mm_srli_si128(bits, 8));
+		row = _mm_or_si128(row, _mm_srli_si128(row, 4));
+		row = _mm_or_si128(row, _mm_srli_si128(row, 2));
+		if ((_mm_extract_epi16(row, 0) | bit8) != ALL_DIGITS)
+		{
+			return false;
+		}
+
+		columns = _mm_or_si128(columns, bits);
+		column8 |= bit8;
+		band = _mm_or_si128(band, bits);
+		band8 |= bit8;
+		if (r % 3 == 2)
+		{
+			// boxes are lanes 0-2, 3-5, and 6-7 with cell 8
+			__m128i boxes = _mm_or_si128(band, _mm_or_si128(_mm_srli_si128(band, 2), _mm_srli_si128(band, 4)));
+			if (_mm_extract_epi16(boxes, 0) != ALL_DIGITS || _mm_extract_epi16(boxes, 3) != ALL_DIGITS ||
+				(_mm_extract_epi16(band, 6) | _mm_extract_epi16(band, 7) | band8) != ALL_DIGITS)
+			{
+				return false;
+			}
+			band = _mm_setzero_si128();
+			band8 = 0;
+		}
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi16(columns, _mm_set1_epi16(ALL_DIGITS))) == 0xFFFF &&
+		column8 == ALL_DIGITS;
+}
+
+#endif /* SUDOKU_X86_KERNELS */
+
+// the best set this CPU runs, or the one named by $SUDOKU_KERNELS if it can
+static SudokuKernels pickKernels()
+{
+	static const SudokuKernels scalar = { "scalar", candidatesScalar, fewestCandidatesScalar, validGridScalar };
+	const char *wanted = getenv("SUDOKU_KERNELS");
+#ifdef SUDOKU_X86_KERNELS
+	static const SudokuKernels sse = { "sse4.2", candidatesSse, fewestCandidatesSse, validGridSse };
+	static const SudokuKernels avx2 = { "avx2", candidatesAvx2, fewestCandidatesAvx2, validGridSse };
+	__builtin_cpu_init();
+	bool hasSse = __builtin_cpu_supports("sse4.2") != 0;
+	bool hasAvx2 = hasSse && __builtin_cpu_supports("avx2") != 0;
+	if (wanted != NULL && strcmp(wanted, "scalar") == 0)
+	{
+		return scalar;
+	}
+	if (hasAvx2 && (wanted == NULL || strcmp(wanted, "avx2") == 0))
+	{
+		return avx2;
+	}
+	if (hasSse)
+	{
+		return sse;
+	}
+#else
+	(void)wanted;
+#endif
+	return scalar;
+}
+
+const SudokuKernels &sudokuKernels()
+{
+	static const SudokuKernels kernels = pickKernels();
+	return kernels;
+}
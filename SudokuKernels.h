@@ -0,0 +1,35 @@
+// Vector kernels for the hot loops of the 9x9 board.
+//
+// Each kernel has an AVX2, an SSE4.2 and a plain C++ version. The first call to
+// sudokuKernels() picks the best set the CPU supports, so one binary runs
+// anywhere; the vector versions are compiled with per-function target
+// attributes and need no extra compiler flags. Other CPUs, and compilers
+// without the x86 intrinsics, get the scalar set.
+//
+// cells is the row-major grid, 81 bytes of 0 (empty) to 9. The masks are the
+// occupancy masks of BasicSudoku<3>, bit k-1 set when k is used in that unit.
+
+#ifndef __SUDOKU_KERNELS_
+#define __SUDOKU_KERNELS_
+
+struct SudokuKernels
+{
+	const char *name;	// "avx2", "sse4.2" or "scalar"
+
+	// candidate mask of every cell into out[0..80], 0 for a filled cell. out must
+	// have room for 96 entries, the vector versions write past the last cell
+	void (*candidates)(const unsigned char *cells, const unsigned short *rowMask,
+		const unsigned short *colMask, const unsigned short *boxMask, unsigned short *out);
+
+	// the empty cell to branch on: the first with 2 or fewer candidates, else the
+	// first with the fewest. -1 if the grid is full
+	int (*fewestCandidates)(const unsigned char *cells, const unsigned short *rowMask,
+		const unsigned short *colMask, const unsigned short *boxMask);
+
+	// true if every row, column and box holds each of 1..9 exactly once
+	bool (*validGrid)(const unsigned char *cells);
+};
+
+const SudokuKernels &sudokuKernels();
+
+#endif /* __SUDOKU_KERNELS_ */
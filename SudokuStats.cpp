@@ -0,0 +1,87 @@
+#include "SudokuStats.h"
+
+SudokuTrace::SudokuTrace(const char *filename, int size)
+{
+	used = 0;
+	searches = 0;
+	file = fopen(filename, "wb");
+	if (file != NULL)
+	{
+		put('S');
+		put('D');
+		put('K');
+		put('T');
+		put(1);
+		put(size);
+	}
+}
+
+SudokuTrace::~SudokuTrace()
+{
+	if (file != NULL)
+	{
+		flush();
+		fclose(file);
+	}
+}
+
+bool SudokuTrace::isOpen() const
+{
+	return file != NULL;
+}
+
+void SudokuTrace::puzzle()
+{
+	put('P');
+	put32(searches++);
+}
+
+void SudokuTrace::branch(int depth, int cell, int digit)
+{
+	put('B');
+	put16(depth);
+	put16(cell);
+	put(digit);
+}
+
+void SudokuTrace::undo(int depth)
+{
+	put('U');
+	put16(depth);
+}
+
+void SudokuTrace::result(bool solved)
+{
+	put('R');
+	put(solved ? 1 : 0);
+}
+
+void SudokuTrace::flush()
+{
+	if (file != NULL && used > 0)
+	{
+		fwrite(buffer, 1, used, file);
+	}
+	used = 0;
+}
+
+void SudokuTrace::put(unsigned char byte)
+{
+	if (used == BUFFER_SIZE)
+	{
+		flush();
+	}
+	buffer[used++] = byte;
+}
+
+void SudokuTrace::put16(unsigned value)
+{
+	put(value & 0xFF);
+	put((value >> 8) & 0xFF);
+}
+
+void SudokuTrace::put32(unsigned long value)
+{
+	put16(value & 0xFFFF);
+	put16((value >> 16) & 0xFFFF);
+}
@@ -0,0 +1,78 @@
+// Search statistics and branching traces for the Sudoku solvers.
+//
+// Both are compiled in only when SUDOKU_STATS is defined (-DSUDOKU_STATS). Without
+// it every SUDOKU_STAT(...) statement disappears, the counters stay at zero and a
+// trace attached with setTrace() is never written to, so the solvers run exactly
+// the code they would without instrumentation.
+
+#ifndef __SUDOKU_STATS_
+#define __SUDOKU_STATS_
+
+#include <cstdio>
+
+#ifdef SUDOKU_STATS
+#define SUDOKU_STAT(statement) statement
+#else
+#define SUDOKU_STAT(statement)
+#endif
+
+// counters for the last solve() / solveWithin() / countSolutions() call
+struct SudokuStats
+{
+	long nodes;					// search nodes entered
+	long backtracks;			// digits tried and taken back
+	int maxDepth;				// deepest branching level reached
+	long propagations;			// cells filled by singles propagation
+	double propagateSeconds;	// time spent propagating
+	double totalSeconds;		// time spent in the whole call, search = total - propagate
+
+	SudokuStats() { reset(); }
+	void reset()
+	{
+		nodes = backtracks = propagations = 0;
+		maxDepth = 0;
+		propagateSeconds = totalSeconds = 0;
+	}
+};
+
+// Writes the branching decisions of a search to a compact binary file.
+//
+// The file starts with the 4 bytes "SDKT", a version byte (1) and the board size
+// (9 for 9x9). Then come records of a one byte type followed by little-endian
+// fields:
+//   'P' puzzle  : u32 search number          start of a new search, counting from 0
+//   'B' branch  : u16 depth, u16 cell, u8 digit   digit tried at cell
+//   'U' undo    : u16 depth                  last branch at depth failed
+//   'R' result  : u8 solved (1) or not (0)   end of the search
+// Records are buffered and written in large blocks. A trace is not thread safe,
+// give each solver thread its own.
+class SudokuTrace
+{
+public:
+	SudokuTrace(const char *filename, int size);
+	~SudokuTrace();
+
+	bool isOpen() const;
+	void puzzle();
+	void branch(int depth, int cell, int digit);
+	void undo(int depth);
+	void result(bool solved);
+	void flush();
+
+private:
+	enum { BUFFER_SIZE = 1 << 16 };
+
+	FILE *file;
+	unsigned char buffer[BUFFER_SIZE];
+	int used;
+	unsigned long searches;		// 'P' records written so far
+
+	void put(unsigned char byte);
+	void put16(unsigned value);
+	void put32(unsigned long value);
+
+	SudokuTrace(const SudokuTrace &);
+	SudokuTrace &operator=(const SudokuTrace &);
+};
+
+#endif /* __SUDOKU_STATS_ */
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+
+// pool and worker index of the calling thread, so nested submits stay local
+static thread_local ThreadPool *currentPool = 0;
+static thread_local int currentWorker = -1;
+
+ThreadPool::ThreadPool(int threads)
+	: pending(0), queued(0), nextWorker(0), stopping(false)
+{
+	if (threads <= 0)
+	{
+		threads = std::thread::hardware_concurrency();
+		if (threads <= 0)
+		{
+			threads = 1;
+		}
+	}
+	for (int i = 0; i < threads; i++)
+	{
+		workers.push_back(std::unique_ptr<Worker>(new Worker));
+	}
+	for (int i = 0; i < threads; i++)
+	{
+		this->threads.push_back(std::thread(&ThreadPool::run, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> guard(idleLock);
+		stopping = true;
+	}
+	idle.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+int ThreadPool::size() const
+{
+	return (int)workers.size();
+}
+
+void ThreadPool::submit(Task task)
+{
+	int index;
+	if (currentPool == this)
+	{
+		index = currentWorker;
+	}
+	else
+	{
+		index = nextWorker++ % workers.size();
+	}
+
+	pending++;
+	{
+		std::lock_guard<std::mutex> guard(workers[index]->lock);
+		workers[index]->tasks.push_back(std::move(task));
+		queued++;
+	}
+	// taking idleLock orders this with a worker that is about to sleep
+	{
+		std::lock_guard<std::mutex> guard(idleLock);
+	}
+	idle.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(idleLock);
+	finished.wait(lock, [this] { return pending == 0; });
+}
+
+// newest task from our own deque, otherwise the oldest task of another worker
+bool ThreadPool::take(int index, Task &task)
+{
+	int count = (int)workers.size();
+	for (int n = 0; n < count; n++)
+	{
+		Worker &w = *workers[(index + n) % count];
+		std::lock_guard<std::mutex> guard(w.lock);
+		if (w.tasks.empty())
+		{
+			continue;
+		}
+		if (n == 0)
+		{
+			task = std::move(w.tasks.back());
+			w.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(w.tasks.front());
+			w.tasks.pop_front();
+		}
+		queued--;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(int index)
+{
+	currentPool = this;
+	currentWorker = index;
+
+	Task task;
+	for (;;)
+	{
+		if (take(index, task))
+		{
+			task(index);
+			task = Task();
+			if (--pending == 0)
+			{
+				std::lock_guard<std::mutex> guard(idleLock);
+				finished.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(idleLock);
+		idle.wait(lock, [this] { return queued > 0 || stopping; });
+		if (stopping && queued == 0)
+		{
+			return;
+		}
+	}
+}
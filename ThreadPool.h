@@ -0,0 +1,59 @@
+// Fixed-size work-stealing thread pool.
+//
+// Each worker owns a deque of tasks. A worker pops the newest task from its own
+// deque and, once that is empty, steals the oldest task from another worker.
+// Tasks submitted from inside a running task go on the submitting worker's deque,
+// so a task can split its work and let idle workers steal the pieces.
+
+#ifndef __THREAD_POOL_
+#define __THREAD_POOL_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// the argument is the index of the worker running the task, 0 .. size()-1
+	typedef std::function<void(int)> Task;
+
+	// threads == 0 starts one worker per hardware thread
+	explicit ThreadPool(int threads = 0);
+	~ThreadPool();
+
+	int size() const;
+	void submit(Task task);
+	// blocks until every submitted task, including ones submitted by tasks, has run
+	void wait();
+
+private:
+	struct Worker
+	{
+		std::deque<Task> tasks;
+		std::mutex lock;
+	};
+
+	std::vector<std::unique_ptr<Worker> > workers;
+	std::vector<std::thread> threads;
+	std::mutex idleLock;
+	std::condition_variable idle;		// signalled when work is queued or on shutdown
+	std::condition_variable finished;	// signalled when pending drops to 0
+	std::atomic<long> pending;			// submitted but not yet finished
+	std::atomic<long> queued;			// submitted but not yet started
+	std::atomic<unsigned> nextWorker;	// round robin for submits from outside the pool
+	bool stopping;
+
+	void run(int index);
+	bool take(int index, Task &task);
+
+	ThreadPool(const ThreadPool &);
+	ThreadPool &operator=(const ThreadPool &);
+};
+
+#endif /* __THREAD_POOL_ */
@@ -0,0 +1,23 @@
+/**
+ * @file   activeobject.h
+ * @brief  Host stand-in for the active object base: an event queue and the
+ *         function the scheduler hands its events to
+ */
+
+#ifndef __ACTIVEOBJECT_
+#define __ACTIVEOBJECT_
+
+#include "eventqueue.h"
+
+typedef struct ActiveObject *ActiveObjectPtr;
+typedef void (*ActiveObjectDispatch)(ActiveObjectPtr, EventPtr);
+
+typedef struct ActiveObject {
+	EventQueue eventQueue;
+	ActiveObjectDispatch dispatch;
+} ActiveObject;
+
+//queues event for ao, false if its queue is full (the event is freed)
+bool activeObjectPost(ActiveObjectPtr ao, EventConstPtr event);
+
+#endif /* __ACTIVEOBJECT_ */
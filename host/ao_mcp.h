@@ -0,0 +1,21 @@
+/**
+ * @file   ao_mcp.h
+ * @brief  Host stand-in for the MCP active object that forwards sensor data to
+ *         the analytics
+ */
+
+#ifndef __AO_MCP_
+#define __AO_MCP_
+
+#include "activeobject.h"
+#include "sensor.h"
+
+//sends one value to every analytic subscribed to the sensor. returns the
+//number of analytics, each of which will answer with an ACK_SIG
+int McpSendSensorDataToAnalytics(ActiveObjectPtr ao, SensorData data, uint16_t dtype);
+//sends count values that belong together, one measurement, to every analytic in
+//one message. returns the number of analytics, each of which will answer with one
+//ACK_SIG for the whole record
+int McpSendSensorRecordToAnalytics(ActiveObjectPtr ao, const SensorData *values, uint8_t count, uint16_t dtype);
+
+#endif /* __AO_MCP_ */
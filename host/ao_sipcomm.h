@@ -0,0 +1,14 @@
+/**
+ * @file   ao_sipcomm.h
+ * @brief  Host stand-in for the SIP communication active object
+ */
+
+#ifndef __AO_SIPCOMM_
+#define __AO_SIPCOMM_
+
+#include "event.h"
+
+//the type and signal of the event the next SIP command returns
+void SipCommSetEventReturn(EventType type, Signal signal);
+
+#endif /* __AO_SIPCOMM_ */
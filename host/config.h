@@ -0,0 +1,15 @@
+/**
+ * @file   config.h
+ * @brief  Host stand-in for the firmware config.h: the basic types and libc
+ *         headers the sensor drivers expect to get from it
+ */
+
+#ifndef __CONFIG_
+#define __CONFIG_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#endif /* __CONFIG_ */
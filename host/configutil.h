@@ -0,0 +1,13 @@
+/**
+ * @file   configutil.h
+ * @brief  Host stand-in for the configuration time allocator
+ */
+
+#ifndef __CONFIGUTIL_
+#define __CONFIGUTIL_
+
+#include "config.h"
+
+void *configutilCalloc(size_t count, size_t size);
+
+#endif /* __CONFIGUTIL_ */
@@ -0,0 +1,46 @@
+/**
+ * @file   event.h
+ * @brief  Host stand-in for the firmware events: a signal, and for array events
+ *         the bytes a SIP command returned
+ */
+
+#ifndef __EVENT_
+#define __EVENT_
+
+#include "config.h"
+
+typedef enum {
+	NULL_SIG,
+	STATE_TRAN_SIG,		//entering a state
+	ACK_SIG,			//a SIP command or an analytic finished
+	TIMEOUT_SIG,		//the sensor object ran out of time
+	TIMER_SIG,			//a timer armed with timerArm expired
+	USER_SIG
+} Signal;
+
+//how a SIP command returns its result
+typedef enum {
+	EVENT_TYPE_SIMPLE,	//just the signal
+	EVENT_TYPE_U8ARRAY	//the signal and up to ARRAY_EVENT_BYTES bytes
+} EventType;
+
+struct ActiveObject;
+
+typedef struct Event {
+	Signal signal;
+	EventType type;
+	struct ActiveObject *sender;
+} Event, *EventPtr;
+typedef const Event *EventConstPtr;
+
+#define ARRAY_EVENT_BYTES	64
+
+typedef struct {
+	Event super;
+	uint8_t length;		//bytes of data that are valid
+	union {
+		uint8_t u8[ARRAY_EVENT_BYTES];
+	} data;
+} ArrayEvent, *ArrayEventPtr;
+
+#endif /* __EVENT_ */
@@ -0,0 +1,18 @@
+/**
+ * @file   eventpool.h
+ * @brief  Host stand-in for the event pool. every block is ArrayEvent sized, as
+ *         on the board, and comes back zeroed
+ */
+
+#ifndef __EVENTPOOL_
+#define __EVENTPOOL_
+
+#include "event.h"
+
+#define EVENT_POOL_SIZE		16
+
+//NULL when the pool is empty
+EventPtr eventPoolAlloc(void);
+void eventPoolFree(EventConstPtr event);
+
+#endif /* __EVENTPOOL_ */
@@ -0,0 +1,27 @@
+/**
+ * @file   eventqueue.h
+ * @brief  Host stand-in for the per active object event queue, a ring of event
+ *         pointers over storage the owner allocates
+ */
+
+#ifndef __EVENTQUEUE_
+#define __EVENTQUEUE_
+
+#include "event.h"
+
+typedef struct {
+	EventConstPtr *ring;
+	uint16_t size;
+	uint16_t head;
+	uint16_t count;
+} EventQueue, *EventQueuePtr;
+
+void eventQueueInit(EventQueuePtr queue, EventConstPtr *ring, uint16_t size);
+//false when the queue is full
+bool eventQueuePut(EventQueuePtr queue, EventConstPtr event);
+//NULL when the queue is empty
+EventConstPtr eventQueueGet(EventQueuePtr queue);
+//drops every queued event and returns it to the pool
+void eventQueueFlush(EventQueuePtr queue);
+
+#endif /* __EVENTQUEUE_ */
@@ -0,0 +1,11 @@
+/**
+ * @file   firmwareDefaults.h
+ * @brief  Host stand-in for the firmware-wide defaults used by the drivers
+ */
+
+#ifndef __FIRMWARE_DEFAULTS_
+#define __FIRMWARE_DEFAULTS_
+
+#define FIRMWARE_DEFAULT_POLLED_SENSOR_QUEUE_SIZE	8
+
+#endif /* __FIRMWARE_DEFAULTS_ */
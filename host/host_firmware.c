@@ -0,0 +1,449 @@
+/**
+ * @file   host_firmware.c
+ * @brief  Host stand-ins for the firmware services a sensor driver links
+ *         against: event pool and queues, scheduler, sensor base, SIP port,
+ *         MCP, logger, timer and board utilities
+ *
+ * Only what the drivers need to run is modelled. One sensor talks to the SIP
+ * port at a time, as on the board, so the port returns its events to the
+ * sensor constructed last. Everything runs on the harness thread, except the
+ * receive interrupt, which gets a thread of its own.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "config.h"
+#include "event.h"
+#include "eventpool.h"
+#include "eventqueue.h"
+#include "activeobject.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "logger.h"
+#include "util.h"
+#include "configutil.h"
+#include "sensor.h"
+#include "sip_api.h"
+#include "ao_sipcomm.h"
+#include "ao_mcp.h"
+#include "host_firmware.h"
+
+HostStats hostStats;
+
+static bool verbose;
+static int analytics = 1;
+
+static const uint8_t *uartSource;
+static size_t uartLength;
+static _Atomic size_t uartOffset;	//advanced by the interrupt thread too
+static size_t uartReadBytes = ARRAY_EVENT_BYTES;
+
+static SipUartRxHandler rxHandler;
+static void *rxContext;
+static unsigned long rxRate;
+static int (*rxFull)(void *);
+static void *rxFullContext;
+static pthread_t rxThread;
+static bool rxRunning;
+
+static SensorActiveObjectPtr sipSensor;		//gets the SIP port's events
+static EventType returnType = EVENT_TYPE_SIMPLE;
+static Signal returnSignal = ACK_SIG;
+
+//timers, one per active object
+#define HOST_TIMERS		4
+
+typedef struct {
+	ActiveObjectPtr ao;		//NULL for a free timer
+	uint64_t due;
+	Signal signal;
+} HostTimer;
+
+static HostTimer timers[HOST_TIMERS];
+
+//event pool
+static ArrayEvent poolBlocks[EVENT_POOL_SIZE];
+static EventPtr poolFree[EVENT_POOL_SIZE];
+static int poolCount = -1;		//free blocks, -1 until first use
+
+EventPtr eventPoolAlloc(void)
+{
+	EventPtr event;
+
+	if (poolCount < 0) {
+		for (poolCount = 0; poolCount < EVENT_POOL_SIZE; poolCount++)
+			poolFree[poolCount] = &poolBlocks[poolCount].super;
+	}
+	if (poolCount == 0)
+		return NULL;
+	event = poolFree[--poolCount];
+	memset(event, 0, sizeof (ArrayEvent));
+	return event;
+}
+
+void eventPoolFree(EventConstPtr event)
+{
+	poolFree[poolCount++] = (EventPtr)event;
+}
+
+//event queues
+void eventQueueInit(EventQueuePtr queue, EventConstPtr *ring, uint16_t size)
+{
+	queue->ring = ring;
+	queue->size = size;
+	queue->head = 0;
+	queue->count = 0;
+}
+
+bool eventQueuePut(EventQueuePtr queue, EventConstPtr event)
+{
+	if (queue->count == queue->size)
+		return false;
+	queue->ring[(queue->head + queue->count) % queue->size] = event;
+	queue->count++;
+	return true;
+}
+
+EventConstPtr eventQueueGet(EventQueuePtr queue)
+{
+	EventConstPtr event;
+
+	if (queue->count == 0)
+		return NULL;
+	event = queue->ring[queue->head];
+	queue->head = (queue->head + 1) % queue->size;
+	queue->count--;
+	return event;
+}
+
+void eventQueueFlush(EventQueuePtr queue)
+{
+	EventConstPtr event;
+
+	while ((event = eventQueueGet(queue)) != NULL)
+		eventPoolFree(event);
+}
+
+//active objects and scheduler
+bool activeObjectPost(ActiveObjectPtr ao, EventConstPtr event)
+{
+	if (eventQueuePut(&ao->eventQueue, event))
+		return true;
+	hostStats.eventsDropped++;
+	eventPoolFree(event);
+	return false;
+}
+
+static void postSignal(ActiveObjectPtr ao, EventType type, Signal signal);
+
+//moves the clock to the timer of ao and fires it. false if it has none. the
+//receive interrupt gets the processor meanwhile, as it would while the board waits
+static bool fireTimer(ActiveObjectPtr ao)
+{
+	int t;
+
+	for (t = 0; t < HOST_TIMERS; t++) {
+		if (timers[t].ao == ao) {
+			if (rxRunning)
+				sched_yield();
+			timers[t].ao = NULL;
+			if (timers[t].due > hostStats.msElapsed)
+				hostStats.msElapsed = timers[t].due;
+			postSignal(ao, EVENT_TYPE_SIMPLE, timers[t].signal);
+			return true;
+		}
+	}
+	return false;
+}
+
+int schedulerRun(ActiveObjectPtr ao)
+{
+	EventConstPtr event;
+	int dispatched = 0;
+
+	do {
+		while ((event = eventQueueGet(&ao->eventQueue)) != NULL) {
+			ao->dispatch(ao, (EventPtr)event);
+			eventPoolFree(event);
+			dispatched++;
+		}
+	} while (fireTimer(ao));
+	return dispatched;
+}
+
+static void postSignal(ActiveObjectPtr ao, EventType type, Signal signal)
+{
+	EventPtr event = eventPoolAlloc();
+
+	if (event == NULL) {
+		hostStats.eventsDropped++;
+		return;
+	}
+	event->signal = signal;
+	event->type = type;
+	activeObjectPost(ao, event);
+}
+
+//sensor base
+static void sensorDispatch(ActiveObjectPtr ao, EventPtr event)
+{
+	SensorActiveObjectPtr me = (SensorActiveObjectPtr)ao;
+
+	me->handler(me, event);
+}
+
+void SensorCtor(SensorActiveObjectPtr me, EventConstPtr *queue, uint16_t queueSize, SensorSuperConfigPtr config)
+{
+	eventQueueInit(&me->ao_super.eventQueue, queue, queueSize);
+	me->ao_super.dispatch = sensorDispatch;
+	me->config = config;
+	me->handler = sensorHandleDefaultState;
+	me->state = SENSOR_STATE_IDLE;
+	me->ackCount = 0;
+	sipSensor = me;
+}
+
+void sensorStateTransition(SensorActiveObjectPtr me, SensorStateHandler handler, int state, Signal signal)
+{
+	me->handler = handler;
+	me->state = state;
+	postSignal(&me->ao_super, EVENT_TYPE_SIMPLE, signal);
+}
+
+void sensorHandleDefaultState(SensorActiveObjectPtr me, EventPtr event)
+{
+	if (event->signal == STATE_TRAN_SIG && me->state == SENSOR_STATE_SAMPLE_MAIN_RETURN) {
+		hostStats.samples++;
+		me->state = SENSOR_STATE_IDLE;
+	}
+}
+
+//SIP port
+void SipCommSetEventReturn(EventType type, Signal signal)
+{
+	returnType = type;
+	returnSignal = signal;
+}
+
+void SIP_SensorUartWrite(SipSensorId sid, char *buffer, uint8_t len)
+{
+	(void)sid;
+	(void)buffer;
+	(void)len;
+	hostStats.uartWrites++;
+	postSignal(&sipSensor->ao_super, returnType, returnSignal);
+}
+
+void SIP_SensorUartRead(SipSensorId sid)
+{
+	ArrayEventPtr event = (ArrayEventPtr)eventPoolAlloc();
+	size_t length = uartLength - uartOffset;
+
+	(void)sid;
+	hostStats.uartReads++;
+	if (event == NULL) {
+		hostStats.eventsDropped++;
+		return;
+	}
+	if (length > uartReadBytes)
+		length = uartReadBytes;
+	memcpy(event->data.u8, uartSource + uartOffset, length);
+	event->length = (uint8_t)length;
+	uartOffset += length;
+	hostStats.uartBytes += length;
+	event->super.signal = returnSignal;
+	event->super.type = returnType;
+	activeObjectPost(&sipSensor->ao_super, &event->super);
+}
+
+void SIP_SensorUartSetRxInterrupt(SipSensorId sid, SipUartRxHandler handler, void *context)
+{
+	(void)sid;
+	rxHandler = handler;
+	rxContext = context;
+}
+
+static double nowSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void *receiveInterrupts(void *unused)
+{
+	double start = nowSeconds();
+	size_t first = uartOffset, offset;
+
+	(void)unused;
+	for (offset = first; offset < uartLength; offset++) {
+		if (rxRate) {
+			double due = start + (offset - first) / (double)rxRate;
+
+			while (nowSeconds() < due)
+				;
+		} else {
+			while (rxFull(rxFullContext))
+				sched_yield();
+		}
+		rxHandler(rxContext, uartSource[offset]);
+		atomic_store_explicit(&uartOffset, offset + 1, memory_order_release);
+	}
+	return NULL;
+}
+
+void hostUartStartInterrupts(unsigned long bytesPerSecond, int (*full)(void *), void *context)
+{
+	if (rxHandler == NULL) {
+		fprintf(stderr, "host: no receive interrupt handler set\n");
+		exit(1);
+	}
+	rxRate = bytesPerSecond;
+	rxFull = full;
+	rxFullContext = context;
+	hostStats.uartBytes += uartLength - uartOffset;
+	rxRunning = true;
+	pthread_create(&rxThread, NULL, receiveInterrupts, NULL);
+}
+
+void hostUartStopInterrupts(void)
+{
+	pthread_join(rxThread, NULL);
+	rxRunning = false;
+}
+
+//MCP. every analytic takes the data at once and answers with an ACK_SIG
+static int mcpSend(ActiveObjectPtr ao, const SensorData *values, uint8_t count)
+{
+	int a;
+	uint8_t v;
+
+	hostStats.messages++;
+	for (v = 0; v < count; v++) {
+		hostStats.fields++;
+		hostStats.fieldChecksum = hostStats.fieldChecksum * 31 + values[v].u;
+		if (verbose)
+			fprintf(stderr, "field %u\n", (unsigned)values[v].u);
+	}
+	for (a = 0; a < analytics; a++)
+		postSignal(ao, EVENT_TYPE_SIMPLE, ACK_SIG);
+	return analytics;
+}
+
+int McpSendSensorDataToAnalytics(ActiveObjectPtr ao, SensorData data, uint16_t dtype)
+{
+	(void)dtype;
+	return mcpSend(ao, &data, 1);
+}
+
+int McpSendSensorRecordToAnalytics(ActiveObjectPtr ao, const SensorData *values, uint8_t count, uint16_t dtype)
+{
+	(void)dtype;
+	return mcpSend(ao, values, count);
+}
+
+//logger, timer and utilities
+void loggerWrite(int level, int subsystem, int code, const char *message)
+{
+	(void)subsystem;
+	(void)code;
+	hostStats.logs++;
+	if (verbose)
+		fprintf(stderr, "log %d: %s\n", level, message);
+}
+
+void delayMs(uint32_t ms)
+{
+	hostStats.msElapsed += ms;
+	hostStats.msDelayed += ms;
+}
+
+void timerArm(ActiveObjectPtr ao, uint32_t ms, Signal signal)
+{
+	int t, slot = -1;
+
+	for (t = 0; t < HOST_TIMERS; t++) {
+		if (timers[t].ao == ao || (timers[t].ao == NULL && slot < 0))
+			slot = t;
+	}
+	if (slot < 0) {
+		fprintf(stderr, "host: more than %d timers armed\n", HOST_TIMERS);
+		exit(1);
+	}
+	timers[slot].ao = ao;
+	timers[slot].due = hostStats.msElapsed + ms;
+	timers[slot].signal = signal;
+}
+
+void timerDisarm(ActiveObjectPtr ao)
+{
+	int t;
+
+	for (t = 0; t < HOST_TIMERS; t++) {
+		if (timers[t].ao == ao)
+			timers[t].ao = NULL;
+	}
+}
+
+void bspPrint(const char *text)
+{
+	hostStats.prints++;
+	if (verbose)
+		fprintf(stderr, "%s\n", text);
+}
+
+void unexpectedSignal(const char *where, const char *state, Signal signal)
+{
+	hostStats.unexpected++;
+	if (verbose)
+		fprintf(stderr, "unexpected signal %d in %s, %s\n", (int)signal, where, state);
+}
+
+void *configutilCalloc(size_t count, size_t size)
+{
+	return calloc(count, size);
+}
+
+//harness controls
+void hostSetVerbose(bool on)
+{
+	verbose = on;
+}
+
+void hostUartSetSource(const uint8_t *bytes, size_t length)
+{
+	uartSource = bytes;
+	uartLength = length;
+	uartOffset = 0;
+}
+
+void hostUartSetReadBytes(size_t bytes)
+{
+	uartReadBytes = bytes < 1 || bytes > ARRAY_EVENT_BYTES ? ARRAY_EVENT_BYTES : bytes;
+}
+
+size_t hostUartOffset(void)
+{
+	return uartOffset;
+}
+
+size_t hostUartRemaining(void)
+{
+	return uartLength - uartOffset;
+}
+
+void hostSetAnalytics(int count)
+{
+	analytics = count;
+}
+
+void hostResetStats(void)
+{
+	memset(&hostStats, 0, sizeof hostStats);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file   host_firmware.h
+ * @brief  Controls of the host stand-ins for the firmware services, for the
+ *         replay harness
+ *
+ * The stand-ins run a sensor driver on Linux: SIP commands complete at once by
+ * queueing their return event, the UART reads come from a byte stream the
+ * harness installs, and what the driver sends to the analytics, the logger or
+ * the debug UART is counted in hostStats instead of leaving the board.
+ */
+
+#ifndef __HOST_FIRMWARE_
+#define __HOST_FIRMWARE_
+
+#include "sensor.h"
+
+typedef struct {
+	uint32_t uartWrites;
+	uint32_t uartReads;
+	uint64_t uartBytes;			//delivered by reads
+	uint64_t fields;			//values sent to the analytics
+	uint64_t messages;			//MCP submissions carrying them
+	uint32_t fieldChecksum;		//of the values in order, to compare parsers
+	uint32_t samples;			//sample FSMs that returned to the sensor
+	uint32_t unexpected;		//UNEXPECTED_SIGNAL calls
+	uint32_t logs;
+	uint32_t prints;
+	uint32_t eventsDropped;		//pool or queue full
+	uint64_t msElapsed;			//simulated clock
+	uint64_t msDelayed;			//of which the scheduler was blocked in delayMs
+} HostStats;
+
+extern HostStats hostStats;
+
+//print the driver's log and debug output to stderr
+void hostSetVerbose(bool verbose);
+//the bytes the sensor UART returns, in order. the stream is not copied
+void hostUartSetSource(const uint8_t *bytes, size_t length);
+//the most bytes one read returns, ARRAY_EVENT_BYTES by default. fewer end reads
+//partway through records, as a UART read that returns what has arrived so far
+void hostUartSetReadBytes(size_t bytes);
+size_t hostUartOffset(void);
+size_t hostUartRemaining(void);
+//starts a thread standing in for the UART receive interrupt: it hands the rest
+//of the source to the handler set with SIP_SensorUartSetRxInterrupt, one byte
+//at a time. at bytesPerSecond, like a real UART, or for 0 as fast as the driver
+//takes them: the thread holds each byte while full(context) is nonzero
+void hostUartStartInterrupts(unsigned long bytesPerSecond, int (*full)(void *), void *context);
+//waits for that thread to deliver the last byte
+void hostUartStopInterrupts(void);
+//analytics subscribed to every sensor, 1 by default
+void hostSetAnalytics(int count);
+void hostResetStats(void);
+
+#endif /* __HOST_FIRMWARE_ */
@@ -0,0 +1,27 @@
+/**
+ * @file   logger.h
+ * @brief  Host stand-in for the logger. messages are counted, and printed to
+ *         stderr when the host runs verbose
+ */
+
+#ifndef __LOGGER_
+#define __LOGGER_
+
+#include "config.h"
+
+enum {
+	LOG_ERROR,
+	LOG_WARN,
+	LOG_INFO,
+	LOG_DEBUG
+};
+
+enum {
+	SUBSYSTEM_ID_SENSOR_AO = 1
+};
+
+void loggerWrite(int level, int subsystem, int code, const char *message);
+
+#define LOGGER(level, subsystem, code, message)	loggerWrite(level, subsystem, code, message)
+
+#endif /* __LOGGER_ */
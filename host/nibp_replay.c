@@ -0,0 +1,341 @@
+/**
+ * @file   nibp_replay.c
+ * @brief  Replays a UART byte stream through the main sensor (NIBP) driver on
+ *         the host, at full speed, and reports how fast it parses
+ *
+ * Build and run from the repository root:
+ *
+ *   gcc -std=gnu11 -O2 -Wall -pthread -I. -Ihost -o nibp_replay main_sensor.c host/host_firmware.c host/nibp_replay.c
+ *   ./nibp_replay [-n frames] [-b every] [-s seed] [-p passes] [-a analytics] [-r rate] [-g ms] [-c bytes] [-w file] [-v] [recording]
+ *
+ * Add -DMAIN_SENSOR_HAS_INTERRUPTS=1 for the driver's interrupt mode. A thread
+ * then stands in for the UART receive interrupt and pushes the stream into the
+ * driver's ring while the driver drains it on its poll timer. With -r it sends
+ * that many bytes per second, like the UART, and reports the bytes the ring had
+ * no room for. Without, it waits whenever the ring is full, so the replay runs
+ * as fast as the driver parses. -g idles that many milliseconds between
+ * samples, as the board does until sensor.c samples again, while the thread
+ * keeps sending; the driver discards what arrived meanwhile as stale.
+ *
+ * A recording is the raw bytes captured from the sensor UART. Without one, a
+ * synthetic stream of -n records is replayed: pulse, quality, gain and
+ * information records with a blood pressure frame (status, cycle, message,
+ * systole/diastole/mean, heart rate, next measurement) every -b records, 5 by
+ * default. -w
+ * saves the synthetic stream, so it can be replayed as a recording later. -c
+ * caps the bytes one polled UART read returns, so reads end partway through
+ * records and the parser has to resume them on the next read.
+ *
+ * Each sample runs the way sensor.c runs it on the board: the sample callback
+ * starts the driver's FSM, the scheduler dispatches events until the queue is
+ * empty, and a driver that has not returned to the sensor by then gets the
+ * sensor timeout. Samples repeat until the stream is used up, -p times over.
+ * The report gives records per second and CPU cycles (TSC ticks; nanoseconds
+ * off x86) per value sent to the analytics, plus a checksum of those values,
+ * so a parser change can be checked for the same output before it is timed.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "config.h"
+#include "eventpool.h"
+#include "scheduler.h"
+#include "main_sensor.h"
+#include "host_firmware.h"
+
+//a sample this long is a parser that stopped making progress
+#define STALL_SECONDS		5
+
+#define BP_FRAME_FIELDS		8
+#define BP_FRAME_BYTES		29
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
+}
+
+static double seconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void stalled(int sig)
+{
+	char message[96];
+	int length;
+
+	(void)sig;
+	length = snprintf(message, sizeof message, "nibp_replay: parser stalled at stream offset %lu\n",
+		(unsigned long)hostUartOffset());
+	write(STDERR_FILENO, message, length);
+	_exit(2);
+}
+
+static uint32_t nextRandom(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+//value as digits raw decimal digit bytes, most significant first
+static uint8_t *putDigits(uint8_t *out, unsigned value, int digits)
+{
+	int d;
+
+	for (d = digits - 1; d >= 0; d--) {
+		out[d] = value % 10;
+		value /= 10;
+	}
+	return out + digits;
+}
+
+//builds frames records into a new buffer. returns its length, and the number
+//of values the records carry in fields
+static size_t synthesize(uint8_t **stream, unsigned long frames, unsigned long every, uint32_t seed, uint64_t *fields)
+{
+	static const uint8_t others[] = {0xFA, 0xFC, 0xF4, 0xFB};
+	uint8_t *out = malloc(frames * BP_FRAME_BYTES + 1);
+	uint32_t state = seed ? seed : 1;
+	unsigned long f;
+
+	*stream = out;
+	*fields = 0;
+	for (f = 0; f < frames; f++) {
+		if (f % every == 0) {
+			unsigned systole = 100 + nextRandom(&state) % 60;
+
+			*out++ = STX;
+			*out++ = 'S';
+			out = putDigits(out, nextRandom(&state) % 4, 1);
+			*out++ = 'C';
+			out = putDigits(out, 15, 2);
+			*out++ = 'M';
+			out = putDigits(out, 0, 2);
+			*out++ = 'P';
+			out = putDigits(out, systole, 3);
+			out = putDigits(out, systole - 40, 3);
+			out = putDigits(out, systole - 25, 3);
+			*out++ = 'R';
+			out = putDigits(out, 50 + nextRandom(&state) % 70, 3);
+			*out++ = 'T';
+			out = putDigits(out, 900, 4);
+			*out++ = ETX;
+			*fields += BP_FRAME_FIELDS;
+		} else {
+			uint8_t kind = others[(f % every - 1) % 4];
+
+			*out++ = kind;
+			*out++ = kind == 0xFA ? 50 + nextRandom(&state) % 70 : nextRandom(&state) % 100;
+			if (kind == 0xFA)
+				*fields += 1;
+		}
+	}
+	return out - *stream;
+}
+
+//records in a recording, counted by their first byte outside blood pressure frames
+static unsigned long countFrames(const uint8_t *stream, size_t length)
+{
+	unsigned long frames = 0;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		if (stream[i] == STX) {
+			while (i < length && stream[i] != ETX)
+				i++;
+			frames++;
+		} else if (stream[i] == 0xFA || stream[i] == 0xFB || stream[i] == 0xFC || stream[i] == 0xF4) {
+			i++;
+			frames++;
+		}
+	}
+	return frames;
+}
+
+static size_t readRecording(const char *path, uint8_t **stream)
+{
+	FILE *file = fopen(path, "rb");
+	size_t capacity = 1 << 16, length = 0, got;
+
+	if (file == NULL) {
+		perror(path);
+		exit(1);
+	}
+	*stream = malloc(capacity);
+	while ((got = fread(*stream + length, 1, capacity - length, file)) > 0) {
+		length += got;
+		if (length == capacity)
+			*stream = realloc(*stream, capacity *= 2);
+	}
+	fclose(file);
+	return length;
+}
+
+#if MAIN_SENSOR_HAS_INTERRUPTS
+static int ringFull(void *sensor)
+{
+	return uartRingFull(&((mainSensorActiveObjectPtr)sensor)->ring);
+}
+#endif
+
+//the time between two samples, in which only the receive interrupt runs
+static void idle(unsigned long ms)
+{
+	struct timespec gap = { ms / 1000, (ms % 1000) * 1000000L };
+
+	nanosleep(&gap, NULL);
+}
+
+//one sample, as sensor.c runs it. false if the driver needed the timeout
+static bool replaySample(SensorActiveObjectPtr sensor)
+{
+	EventPtr timeout;
+
+	sensor->sampleCallback(sensor);
+	schedulerRun(&sensor->ao_super);
+	if (sensor->handler == sensorHandleDefaultState)
+		return true;
+	timeout = eventPoolAlloc();
+	timeout->signal = TIMEOUT_SIG;
+	activeObjectPost(&sensor->ao_super, timeout);
+	schedulerRun(&sensor->ao_super);
+	return false;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: nibp_replay [-n frames] [-b every] [-s seed] [-p passes] [-a analytics] [-r rate] [-g ms] [-c bytes] [-w file] [-v] [recording]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long frames = 100000, every = 5, rate = 0, gap = 0;
+	uint32_t seed = 1;
+	int passes = 1, pass, opt;
+	const char *save = NULL;
+	uint8_t *stream;
+	size_t length;
+	uint64_t expected = 0, start;
+	uint32_t timeouts = 0, samples = 0;
+	double began, elapsed, perField;
+	mainSensorConfig config;
+	SensorActiveObjectPtr sensor;
+
+	while ((opt = getopt(argc, argv, "n:b:s:p:a:r:g:c:w:v")) != -1) {
+		switch (opt) {
+		case 'n': frames = strtoul(optarg, NULL, 10); break;
+		case 'b': every = strtoul(optarg, NULL, 10); break;
+		case 's': seed = strtoul(optarg, NULL, 10); break;
+		case 'p': passes = atoi(optarg); break;
+		case 'a': hostSetAnalytics(atoi(optarg)); break;
+		case 'r': rate = strtoul(optarg, NULL, 10); break;
+		case 'g': gap = strtoul(optarg, NULL, 10); break;
+		case 'c': hostUartSetReadBytes(strtoul(optarg, NULL, 10)); break;
+		case 'w': save = optarg; break;
+		case 'v': hostSetVerbose(true); break;
+		default: usage();
+		}
+	}
+	if (optind < argc - 1 || passes < 1 || every < 1)
+		usage();
+
+	if (optind < argc) {
+		length = readRecording(argv[optind], &stream);
+		frames = countFrames(stream, length);
+	} else {
+		length = synthesize(&stream, frames, every, seed, &expected);
+		if (save != NULL) {
+			FILE *file = fopen(save, "wb");
+
+			if (file == NULL || fwrite(stream, 1, length, file) != length) {
+				perror(save);
+				return 1;
+			}
+			fclose(file);
+		}
+	}
+
+	memset(&config, 0, sizeof config);
+	config.super.sid.portId = 1;
+	config.super.sid.subId = MAIN_SENSOR_SUBID;
+	sensor = (SensorActiveObjectPtr)mainSensorCtor(&config);
+	hostResetStats();
+
+	signal(SIGALRM, stalled);
+	alarm(STALL_SECONDS);
+	began = seconds();
+	start = ticks();
+	for (pass = 0; pass < passes; pass++) {
+		hostUartSetSource(stream, length);
+#if MAIN_SENSOR_HAS_INTERRUPTS
+		hostUartStartInterrupts(rate, ringFull, sensor);
+		while (hostUartRemaining() > 0 || !uartRingEmpty(&((mainSensorActiveObjectPtr)sensor)->ring)) {
+#else
+		(void)rate;
+		while (hostUartRemaining() > 0) {
+#endif
+			if (!replaySample(sensor))
+				timeouts++;
+			if (gap > 0)
+				idle(gap);
+			if ((++samples & 4095) == 0 || gap > 0)
+				alarm(STALL_SECONDS);
+		}
+#if MAIN_SENSOR_HAS_INTERRUPTS
+		hostUartStopInterrupts();
+#endif
+	}
+	perField = hostStats.fields ? (double)(ticks() - start) / hostStats.fields : 0;
+	elapsed = seconds() - began;
+	alarm(0);
+
+	printf("nibp_replay: %s, %lu bytes, %lu records, %d passes, %s, %.3f s\n",
+		optind < argc ? argv[optind] : "synthetic", (unsigned long)length, frames, passes,
+		MAIN_SENSOR_HAS_INTERRUPTS ? "interrupts" : "polled", elapsed);
+	printf("records/sec      %.0f\n", frames * passes / elapsed);
+#if defined(__x86_64__) || defined(__i386__)
+	printf("cycles/field     %.1f\n", perField);
+#else
+	printf("ns/field         %.1f\n", perField);
+#endif
+	printf("fields           %llu", (unsigned long long)hostStats.fields);
+	if (expected)
+		printf(" sent, %llu in the stream", (unsigned long long)(expected * passes));
+	printf(", checksum %08x\n", (unsigned)hostStats.fieldChecksum);
+	printf("mcp messages     %llu\n", (unsigned long long)hostStats.messages);
+	printf("samples          %u, %u ended by the timeout\n", samples, timeouts);
+	printf("uart             %u reads, %llu bytes, %u writes\n", (unsigned)hostStats.uartReads,
+		(unsigned long long)hostStats.uartBytes, (unsigned)hostStats.uartWrites);
+#if MAIN_SENSOR_HAS_INTERRUPTS
+	printf("ring             %lu bytes dropped, %lu discarded as stale\n",
+		(unsigned long)uartRingDropped(&((mainSensorActiveObjectPtr)sensor)->ring),
+		(unsigned long)((mainSensorActiveObjectPtr)sensor)->stale);
+#endif
+	printf("unexpected       %u signals, %u events dropped\n", (unsigned)hostStats.unexpected,
+		(unsigned)hostStats.eventsDropped);
+	printf("simulated time   %.0f s, %.0f s of it blocked in delayMs\n", hostStats.msElapsed / 1000.0,
+		hostStats.msDelayed / 1000.0);
+	free(stream);
+	return 0;
+}
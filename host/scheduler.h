@@ -0,0 +1,16 @@
+/**
+ * @file   scheduler.h
+ * @brief  Host stand-in for the cooperative scheduler
+ */
+
+#ifndef __SCHEDULER_
+#define __SCHEDULER_
+
+#include "activeobject.h"
+
+//dispatches the events queued for ao, and the ones its handlers queue, until
+//the queue is empty and no timer of ao is armed. returns the number of events
+//dispatched
+int schedulerRun(ActiveObjectPtr ao);
+
+#endif /* __SCHEDULER_ */
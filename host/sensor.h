@@ -0,0 +1,68 @@
+/**
+ * @file   sensor.h
+ * @brief  Host stand-in for the generic sensor object the drivers extend
+ */
+
+#ifndef __SENSOR_
+#define __SENSOR_
+
+#include "activeobject.h"
+#include "sip_api.h"
+
+typedef union {
+	uint32_t u;
+	int32_t i;
+	float f;
+} SensorData;
+
+enum {
+	SENSOR_TYPE_TEMPERATURE,
+	SENSOR_TYPE_PRESSURE
+};
+
+enum {
+	SENSOR_PRIM_DTYPE_UINT,
+	SENSOR_PRIM_DTYPE_INT,
+	SENSOR_PRIM_DTYPE_FLOAT
+};
+
+enum {
+	INTERFACE_ASYNC_SERIAL,
+	INTERFACE_I2C,
+	INTERFACE_ONEWIRE
+};
+
+enum {
+	CONDITION_NONE
+};
+
+//states of the default sensor handler
+enum {
+	SENSOR_STATE_IDLE,
+	SENSOR_STATE_SAMPLE_MAIN_RETURN	//a driver's sample FSM has finished
+};
+
+typedef struct {
+	SipSensorId sid;
+} SipSensorConfig, *SipSensorConfigPtr;
+
+typedef SipSensorConfig SensorSuperConfig, *SensorSuperConfigPtr;
+
+typedef struct SensorActiveObject *SensorActiveObjectPtr;
+typedef void (*SensorStateHandler)(SensorActiveObjectPtr, EventPtr);
+
+typedef struct SensorActiveObject {
+	ActiveObject ao_super;
+	SensorSuperConfigPtr config;
+	SensorStateHandler handler;		//gets the events of this sensor
+	int state;						//local state of handler
+	int ackCount;					//analytics yet to ACK the last data
+	void (*sampleCallback)(SensorActiveObjectPtr);
+} SensorActiveObject;
+
+void SensorCtor(SensorActiveObjectPtr me, EventConstPtr *queue, uint16_t queueSize, SensorSuperConfigPtr config);
+//hands the sensor's events to handler, starting in state with signal
+void sensorStateTransition(SensorActiveObjectPtr me, SensorStateHandler handler, int state, Signal signal);
+void sensorHandleDefaultState(SensorActiveObjectPtr me, EventPtr event);
+
+#endif /* __SENSOR_ */
@@ -0,0 +1,30 @@
+/**
+ * @file   sip_api.h
+ * @brief  Host stand-in for the SIP sensor port API. the UART of every port is
+ *         the replay source the host harness installs (see host_firmware.h)
+ */
+
+#ifndef __SIP_API_
+#define __SIP_API_
+
+#include "config.h"
+
+typedef struct {
+	uint8_t portId;
+	uint8_t subId;
+} SipSensorId;
+
+//sends len bytes to the sensor; the port returns the event set by
+//SipCommSetEventReturn once they are out
+void SIP_SensorUartWrite(SipSensorId sid, char *buffer, uint8_t len);
+//returns the next bytes from the sensor, up to ARRAY_EVENT_BYTES, in an array
+//event with the signal set by SipCommSetEventReturn
+void SIP_SensorUartRead(SipSensorId sid);
+
+//called in interrupt context with every byte the port's UART receives
+typedef void (*SipUartRxHandler)(void *context, uint8_t byte);
+
+//enables the receive interrupt of the port, with handler getting its bytes
+void SIP_SensorUartSetRxInterrupt(SipSensorId sid, SipUartRxHandler handler, void *context);
+
+#endif /* __SIP_API_ */
@@ -0,0 +1,11 @@
+/**
+ * @file   sirConfigDefaults.h
+ * @brief  Host stand-in for the SIR configuration defaults used by the drivers
+ */
+
+#ifndef __SIR_CONFIG_DEFAULTS_
+#define __SIR_CONFIG_DEFAULTS_
+
+#define SIR_DEFAULT_SENSOR_SUBID			0
+
+#endif /* __SIR_CONFIG_DEFAULTS_ */
@@ -0,0 +1,21 @@
+/**
+ * @file   timer.h
+ * @brief  Host stand-in for the timer services. the host never sleeps: a delay
+ *         only advances the simulated clock, and when every event has been
+ *         dispatched the scheduler jumps the clock to the next timer, so
+ *         replays run at full speed
+ */
+
+#ifndef __TIMER_
+#define __TIMER_
+
+#include "activeobject.h"
+
+//blocks the caller, and with it the scheduler, for ms
+void delayMs(uint32_t ms);
+//posts signal to ao once ms have passed. an active object has one timer, and
+//arming it again restarts it
+void timerArm(ActiveObjectPtr ao, uint32_t ms, Signal signal);
+void timerDisarm(ActiveObjectPtr ao);
+
+#endif /* __TIMER_ */
@@ -0,0 +1,18 @@
+/**
+ * @file   util.h
+ * @brief  Host stand-in for the board utilities the drivers use
+ */
+
+#ifndef __UTIL_
+#define __UTIL_
+
+#include "event.h"
+
+//the debug UART. counted, and printed to stderr when the host runs verbose
+void bspPrint(const char *text);
+
+void unexpectedSignal(const char *where, const char *state, Signal signal);
+
+#define UNEXPECTED_SIGNAL(where, state, signal)	unexpectedSignal(where, state, signal)
+
+#endif /* __UTIL_ */
@@ -35,6 +35,7 @@
 enum {
 	MAIN_SENSOR_INIT,
 	MAIN_SENSOR_SAMPLE,
+	MAIN_SENSOR_WAIT,
 	SAMPLE_ACK
 
 };
@@ -45,9 +46,14 @@ enum {
 // event - ptr to event. this contains a signal (input), a sender ao, and possibly data from sensors
 static void handleSampleFSM(mainSensorActiveObjectPtr me, EventPtr event);
 
-int bloodPressureEvent(int counter,mainSensorActiveObjectPtr me, EventPtr event);
+static void startPoll(mainSensorActiveObjectPtr me);
+#if MAIN_SENSOR_HAS_INTERRUPTS
+static void discardStale(mainSensorActiveObjectPtr me);
+#endif
 
-int incrementCounter(int counter);
+static void finishPoll(mainSensorActiveObjectPtr me);
+
+static int submitSample(mainSensorActiveObjectPtr me);
 
 
 // DO NOT CHANGE
@@ -57,6 +63,15 @@ void mainSensorSampleCallback(SensorActiveObjectPtr me){
 	sensorStateTransition(me, (SensorStateHandler )handleSampleFSM, MAIN_SENSOR_INIT, STATE_TRAN_SIG);
 }
 
+#if MAIN_SENSOR_HAS_INTERRUPTS
+//UART receive interrupt. it runs in interrupt context, so it only queues the byte
+//for the active object, which parses it on its next poll
+static void mainSensorUartRx(void *context, uint8_t byte)
+{
+	uartRingPush(&((mainSensorActiveObjectPtr)context)->ring, byte);
+}
+#endif
+
 // DO NOT CHANGE
 //This function allocates the active object and event queues, and does any needed initialization
 ActiveObjectPtr mainSensorCtor(mainSensorConfigPtr config){
@@ -68,6 +83,10 @@ ActiveObjectPtr mainSensorCtor(mainSensorConfigPtr config){
 	myQueues = (EventConstPtr *) configutilCalloc(FIRMWARE_DEFAULT_POLLED_SENSOR_QUEUE_SIZE,sizeof(EventConstPtr *));
 	SensorCtor(&me->super,  myQueues, FIRMWARE_DEFAULT_POLLED_SENSOR_QUEUE_SIZE, (SensorSuperConfigPtr) config);
 	me->super.sampleCallback = mainSensorSampleCallback;
+#if MAIN_SENSOR_HAS_INTERRUPTS
+	uartRingInit(&me->ring);
+	SIP_SensorUartSetRxInterrupt(config->super.sid, mainSensorUartRx, me);
+#endif
 
 	return &me->super.ao_super;
 }
@@ -84,8 +103,9 @@ static void handleSampleFSM(mainSensorActiveObjectPtr me, EventPtr event)
 	if(event->signal == TIMEOUT_SIG) {
 		sprintf(buffer,"MAIN_SENSOR TIMEOUT, Port: %d SubID: %d",me->super.config->sid.portId, me->super.config->sid.subId);
 		LOGGER(LOG_ERROR, SUBSYSTEM_ID_SENSOR_AO, 0, buffer);
-		//this clears any existing signals in this sensor object's queue. at this point, we are giving up
-		//so we do not want any remaining signals as this would cause confusion
+		//this stops the poll timer and clears any existing signals in this sensor object's queue. at this
+		//point, we are giving up so we do not want any remaining signals as this would cause confusion
+		timerDisarm(&(me->super.ao_super));
 		eventQueueFlush(&(me->super.ao_super.eventQueue));\
 			//use this function call to return control to the parent sensor.c
 			sensorStateTransition(&(me->super), sensorHandleDefaultState, SENSOR_STATE_SAMPLE_MAIN_RETURN, STATE_TRAN_SIG);
@@ -99,6 +119,9 @@ static void handleSampleFSM(mainSensorActiveObjectPtr me, EventPtr event)
 			if (event->signal == STATE_TRAN_SIG) {
 				LOGGER(LOG_INFO, SUBSYSTEM_ID_SENSOR_AO, 0, "Initializing NIBP");
 				bspPrint("Initializing NIBP\r\n");
+#if MAIN_SENSOR_HAS_INTERRUPTS
+				discardStale(me);
+#endif
 				SipCommSetEventReturn(EVENT_TYPE_SIMPLE,ACK_SIG);
 				buffer[0] = 0;	//read first byte
 				SIP_SensorUartWrite(me->super.config->sid, buffer, 1);
@@ -128,111 +151,47 @@ static void handleSampleFSM(mainSensorActiveObjectPtr me, EventPtr event)
 				UNEXPECTED_SIGNAL("ear_temp.c:handleSampleFSM", "EAR_TEMP_WAKEUP",event->signal);
 			}
 		}
+		break;
 
 	case  MAIN_SENSOR_SAMPLE:
 		{
-			//this is our initial signal. here we send a command to the sensor to perform a reading
+			//this is our initial signal. the cuff starts inflating, and we poll the sensor
+			//right away and then every MAIN_SENSOR_POLL_MS until it has a measurement or
+			//MAIN_SENSOR_INFLATE_MS have passed. between polls we wait in MAIN_SENSOR_WAIT,
+			//so the scheduler runs the other objects while the cuff works
 			if (event->signal == STATE_TRAN_SIG) {
-				//declare this to make things a tiny bit more readable :)
-				delayMs(15000);
-				mainSensorConfigPtr myconfig = (mainSensorConfigPtr)me->super.config;
 				LOGGER(LOG_INFO, SUBSYSTEM_ID_SENSOR_AO, 0, "Reading data from MAIN_SENSOR");
 				bspPrint("Reading data from MAIN_SENSOR");
-				//when we send a command to the sensor, it will return an event once is has finished
-				//this function sets the return type of the event as well as the returned signal
-				//EVENT_TYPE_U8ARRAY - data is returned as an array of bytes (uint8's)
-				//ACK_SIG - this FSM will receive an ACK_SIG when the sensor has finished
-				SipCommSetEventReturn(EVENT_TYPE_U8ARRAY,ACK_SIG);
-
-
-				//the main sensor is a Serial (UART)
-				SIP_SensorUartRead(me->super.config->sid);
-
-
-
-			} else if(event->signal == ACK_SIG) 
-			{
-				SensorData pulse;
-				SensorData sp02;
-
-				int counter = 0;
-				if (counter <64)
-				{
-					//we have received an ACK_SIG in this state which means that the sensor has finished sampling!
-					//we grab the next 2 hex
-					if (((ArrayEventPtr)event)->data.u8[counter] == STX) // Blood pressure
-					{
-						counter = bloodPressureEvent(counter, me, event);
-					}
-
-					else if(((ArrayEventPtr)event)->data.u8[counter] == 0xFA)   // pulse rate
-					{
-						counter = incrementCounter(counter);                    // counter++ with bounds check
-						if (((ArrayEventPtr)event)->data.u8[counter] == STX)   // If blood pressure interrupts
-						{
-							counter = bloodPressureEvent(counter, me, event);   // get new counter (already incremented to new data) after uploading blood pressure event data
-						}
-						pulse.u = ((ArrayEventPtr)event)->data.u8[counter];
-						sprintf(buffer,"Pulse Data, Port: %d Data: %d",me->super.config->sid.portId, pulse.u);
-						bspPrint(buffer);
-						me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), pulse , SENSOR_PRIM_DTYPE_UINT);
-
-					}
-					else if (((ArrayEventPtr)event)->data.u8[counter] == STX)  // Sp02
-					{
-						counter = incrementCounter(counter);                    // counter++ with bounds check
-						if (((ArrayEventPtr)event)->data.u8[counter] == STX)   // If blood pressure interrupts
-						{
-							counter = bloodPressureEvent(counter, me, event);   // new counter value
-						}
-						sp02.u = ((ArrayEventPtr)event)->data.u8[counter];
-						sprintf(buffer,"SpO2 Data, Port: %d Data: %d",me->super.config->sid.portId, sp02.u);
-						bspPrint(buffer);
-						me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), sp02, SENSOR_PRIM_DTYPE_UINT);
-					}
-					// Going to ignore waveform, not too useful 
-					/*else if (((ArrayEventPtr)event)->data.u8[counter] == 0xF8)  // pulse WAVE - 
-					{
-					counter = incrementCounter(counter);                    // counter++ with bounds check
-					if (((ArrayEventPtr)event)->data.u8[counter] == STX)   // If blood pressure interrupts
-					{
-					counter = bloodPressureEvent(counter, me, event);   // new counter value
-					}
-					me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super),((ArrayEventPtr)event)->data.u8[counter], SENSOR_PRIM_DTYPE_UINT);
-					}*/
-					else if ((((ArrayEventPtr)event)->data.u8[counter] == 0xFB) ||  // information
-						(((ArrayEventPtr)event)->data.u8[counter] == 0xFC) ||   // quality
-						(((ArrayEventPtr)event)->data.u8[counter] == 0xF4))     // gain
-					{
-						counter = incrementCounter(counter);
-						// IGNORE THESE FOR NOW
-
-					}
-					else // junk data, or incomplete data
-					{
-						counter = incrementCounter(counter);
-
-					}
-
-
-
-				}
-				else
-				{
-					UNEXPECTED_SIGNAL("test_MAIN_SENSOR.c:handleSampleFSM", "MAIN_SENSOR_SAMPLE",event->signal);
-
+				me->waited = 0;
+				startPoll(me);
+
+			} else if(event->signal == ACK_SIG) {
+				//parse every record in the bytes the read returned. one cut off at its end
+				//stays in the parser, and we read again to finish it
+				if (nibpParse(me, ((ArrayEventPtr)event)->data.u8, ((ArrayEventPtr)event)->length) && me->reads < MAIN_SENSOR_MAX_READS) {
+					me->reads++;
+					SipCommSetEventReturn(EVENT_TYPE_U8ARRAY,ACK_SIG);
+					SIP_SensorUartRead(me->super.config->sid);
+				} else {
+					finishPoll(me);
 				}
 
-
-			}
-
-
-			else {
+			} else {
 				UNEXPECTED_SIGNAL("test_MAIN_SENSOR.c:handleSampleFSM", "MAIN_SENSOR_SAMPLE",event->signal);
 			}
 		}
 		break;
 
+	case  MAIN_SENSOR_WAIT:
+		if (event->signal == TIMER_SIG) {
+			me->waited += MAIN_SENSOR_POLL_MS;
+			me->super.state = MAIN_SENSOR_SAMPLE;
+			startPoll(me);
+		} else {
+			UNEXPECTED_SIGNAL("test_MAIN_SENSOR.c:handleSampleFSM", "MAIN_SENSOR_WAIT",event->signal);
+		}
+		break;
+
 	case  SAMPLE_ACK:
 		if(event->signal == ACK_SIG)
 		{
@@ -240,7 +199,7 @@ static void handleSampleFSM(mainSensorActiveObjectPtr me, EventPtr event)
 			//one ACK_SIG when one analytic has received the data, and we need to wait for all of
 			//the analytics to respond, so we loop in this state until all analytics have ACK'd
 			me->super.ackCount--;
-			if (me->super.ackCount == 0){
+			if (me->super.ackCount <= 0){
 				LOGGER(LOG_INFO, SUBSYSTEM_ID_SENSOR_AO, 0, "mainSensor finished sampling");
 				//this function returns control back to the parent sensor.c; call this when the sampling process has completed
 				sensorStateTransition(&(me->super), sensorHandleDefaultState, SENSOR_STATE_SAMPLE_MAIN_RETURN, STATE_TRAN_SIG);
@@ -256,149 +215,223 @@ static void handleSampleFSM(mainSensorActiveObjectPtr me, EventPtr event)
 
 }
 
-int bloodPressureEvent(int counter, mainSensorActiveObjectPtr me, EventPtr event)   // C can't pass by ref so I am just returning counter
+#if MAIN_SENSOR_HAS_INTERRUPTS
+//parses what the receive interrupt has queued, in place in the ring. the spans are
+//taken once, so the time spent here is bounded however fast the sensor sends
+static void drainRing(mainSensorActiveObjectPtr me)
 {
-	SensorData bloodStatus;     // 'S'
-	SensorData bloodCycle;      // 'C'
-	SensorData bloodMessage;    // 'M'
-	SensorData bloodPressureSystole;   // 'P'
-	SensorData bloodPressureDiastole;  // 'P'
-	SensorData bloodPressureMean;      // 'P' 
-	SensorData bloodHeartRate;   // 'R'
-	SensorData bloodNextEvent;   // 'T'
-
-	counter = incrementCounter(counter);
-
-
-	/*unsigned char bloodArray[64];
-	for (int a = 0; a< 64; a++) // fill all values as X, so we know where to stop 
-	{
-	bloodArray[a] = 'X';   
-	}
-
-	int i = 0;
-	while ((((ArrayEventPtr)event)->data.u8[counter] != ETX) && (counter < 64))    // Looks for blood pressure end of text (ETX) or end of data at 64
-	{                                                                               // counter left on the ETX 
-
-	bloodArray[i] = ((ArrayEventPtr)event)->data.u8[counter+1];
-	counter = incrementCounter(counter);
+	char buffer[64];
+	const uint8_t *span;
+	uint32_t length, dropped;
+	int spans;
 
+	for (spans = 0; spans < 2 && (span = uartRingPeek(&me->ring, &length)) != NULL; spans++) {
+		nibpParse(me, span, length);
+		uartRingConsume(&me->ring, length);
 	}
-	//for (int b = 0; b < 64; b++) // upload all values from bloodArray to server, except X
-	int b = 0;*/
-	while (((ArrayEventPtr)event)->data.u8[counter] != ETX )
-	{
-
-		if (((ArrayEventPtr)event)->data.u8[counter] == 'S') // Status
-		{
-			counter = incrementCounter(counter);
-			bloodStatus.u = ((ArrayEventPtr)event)->data.u8[counter];
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodStatus, SENSOR_PRIM_DTYPE_UINT);
-			counter = incrementCounter(counter);
-		}
-
-		else if (((ArrayEventPtr)event)->data.u8[counter] == 'C') // Cycle time in minutes
-		{
-			counter = incrementCounter(counter);
-			bloodCycle.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);                  // if we run out of data, it will never continue and switch states
-			bloodCycle.u = (10*bloodCycle.u)+ ((ArrayEventPtr)event)->data.u8[counter]; // makes it so if we get 1 and 3, it will show 13 
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodCycle, SENSOR_PRIM_DTYPE_UINT);
-			counter = incrementCounter(counter);
-
-		}
-		else if (((ArrayEventPtr)event)->data.u8[counter] == 'M') // Message
-		{
-			counter = incrementCounter(counter);
-			bloodMessage.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodMessage.u = (10*bloodMessage.u) + ((ArrayEventPtr)event)->data.u8[counter];
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodCycle, SENSOR_PRIM_DTYPE_UINT);
-			counter = incrementCounter(counter);
-		}
-		else if (((ArrayEventPtr)event)->data.u8[counter] == 'P') // blood pressure data
-		{
-			counter = incrementCounter(counter);
-			bloodPressureSystole.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodPressureSystole.u = (10*bloodPressureSystole.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodPressureSystole.u = (10*bloodPressureSystole.u)+ ((ArrayEventPtr)event)->data.u8[counter]; //send a 3 digit number
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodPressureSystole, SENSOR_PRIM_DTYPE_UINT);
-
-			counter = incrementCounter(counter);
-			bloodPressureDiastole.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodPressureDiastole.u = (10*bloodPressureDiastole.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodPressureDiastole.u = (10*bloodPressureDiastole.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodPressureDiastole, SENSOR_PRIM_DTYPE_UINT);
-
-			counter = incrementCounter(counter);
-			bloodPressureMean.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodPressureMean.u = (10*bloodPressureMean.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodPressureMean.u = (10*bloodPressureMean.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodPressureMean, SENSOR_PRIM_DTYPE_UINT);
-			counter = incrementCounter(counter);
+	dropped = uartRingDropped(&me->ring);
+	if (dropped != me->dropped) {
+		sprintf(buffer,"MAIN_SENSOR ring full, %lu bytes dropped",(unsigned long)(dropped - me->dropped));
+		LOGGER(LOG_WARN, SUBSYSTEM_ID_SENSOR_AO, 0, buffer);
+		me->dropped = dropped;
+	}
+}
 
-		}
-		else if (((ArrayEventPtr)event)->data.u8[counter] == 'R') // heart rate pressure
-		{
-			counter = incrementCounter(counter);
-			bloodHeartRate.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodHeartRate.u = (10*bloodHeartRate.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodHeartRate.u = (10*bloodHeartRate.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodHeartRate, SENSOR_PRIM_DTYPE_UINT);
-			counter = incrementCounter(counter);
+//the ring is only drained while a sample runs. what the interrupt queued since the
+//last one (or found no room for) is old by now, so the sample starts from an empty
+//ring and a parser outside any record
+static void discardStale(mainSensorActiveObjectPtr me)
+{
+	char buffer[64];
+	uint32_t stale = uartRingDiscard(&me->ring);
+
+	nibpParserReset(&me->parser);
+	me->dropped = uartRingDropped(&me->ring);
+	if (stale > 0) {
+		sprintf(buffer,"MAIN_SENSOR %lu stale bytes discarded",(unsigned long)stale);
+		LOGGER(LOG_INFO, SUBSYSTEM_ID_SENSOR_AO, 0, buffer);
+		me->stale += stale;
+	}
+}
+#endif
 
-		}
-		else if (((ArrayEventPtr)event)->data.u8[counter] == 'T') // how long in seconds will the next measure occur
-		{
-			counter = incrementCounter(counter);
-			bloodNextEvent.u = ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodNextEvent.u = (10*bloodNextEvent.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodNextEvent.u = (10*bloodNextEvent.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			counter = incrementCounter(counter);
-			bloodNextEvent.u = (10*bloodNextEvent.u)+ ((ArrayEventPtr)event)->data.u8[counter];
-			me->super.ackCount = McpSendSensorDataToAnalytics (&(me->super.ao_super), bloodNextEvent, SENSOR_PRIM_DTYPE_UINT);
-			counter = incrementCounter(counter);
-		}
-		else // junk data or data we are not interested in
-		{
-			incrementCounter(counter); 
-		}
+//polls the sensor once: drains the ring, or starts a read (which may take
+//MAIN_SENSOR_MAX_READS reads) that the FSM continues on ACK_SIG
+static void startPoll(mainSensorActiveObjectPtr me)
+{
+#if MAIN_SENSOR_HAS_INTERRUPTS
+	drainRing(me);
+	finishPoll(me);
+#else
+	me->reads = 1;
+	//when we send a command to the sensor, it will return an event once is has finished
+	//this function sets the return type of the event as well as the returned signal
+	//EVENT_TYPE_U8ARRAY - data is returned as an array of bytes (uint8's)
+	//ACK_SIG - this FSM will receive an ACK_SIG when the sensor has finished
+	SipCommSetEventReturn(EVENT_TYPE_U8ARRAY,ACK_SIG);
+
+	//the main sensor is a Serial (UART)
+	SIP_SensorUartRead(me->super.config->sid);
+#endif
+}
 
+//after a poll: wait for the next one while the cuff is still measuring, then
+//submit what the sample read and wait for the analytics, or return to sensor.c
+static void finishPoll(mainSensorActiveObjectPtr me)
+{
+	if (!me->hasMeasurement && me->waited < MAIN_SENSOR_INFLATE_MS) {
+		me->super.state = MAIN_SENSOR_WAIT;
+		timerArm(&(me->super.ao_super), MAIN_SENSOR_POLL_MS, TIMER_SIG);
+	} else if ((me->super.ackCount = submitSample(me)) > 0) {
+		//wait for the analytics to ACK the data
+		me->super.state = SAMPLE_ACK;
+	} else {
+		LOGGER(LOG_INFO, SUBSYSTEM_ID_SENSOR_AO, 0, "mainSensor finished sampling");
+		sensorStateTransition(&(me->super), sensorHandleDefaultState, SENSOR_STATE_SAMPLE_MAIN_RETURN, STATE_TRAN_SIG);
 	}
-	return incrementCounter(counter);
 }
 
+//submits what the sample read to the analytics: the blood pressure measurement as one
+//record, and the pulse rate. returns the number of ACK_SIGs to wait for, one per
+//analytic and submission
+static int submitSample(mainSensorActiveObjectPtr me)
+{
+	char buffer[64];
+	int acks = 0;
 
+	if (me->hasPulse) {
+		sprintf(buffer,"Pulse Data, Port: %d Data: %d",me->super.config->sid.portId, (int)me->pulse.u);
+		bspPrint(buffer);
+		acks += McpSendSensorDataToAnalytics(&(me->super.ao_super), me->pulse, SENSOR_PRIM_DTYPE_UINT);
+	}
+	if (me->hasMeasurement) {
+		acks += McpSendSensorRecordToAnalytics(&(me->super.ao_super), me->measurement, me->measurementValues, SENSOR_PRIM_DTYPE_UINT);
+	}
+	me->hasPulse = 0;
+	me->hasMeasurement = 0;
+	return acks;
+}
 
+//keeps the values of a complete blood pressure frame as the sample's measurement.
+//a later frame in the same sample replaces it; the cuff measures minutes apart.
+//one without the pressures is not a measurement, and the sample keeps waiting
+static void keepFrame(mainSensorActiveObjectPtr me)
+{
+	NibpParser *p = &me->parser;
+	int slot;
 
-int incrementCounter(int counter)   // checks if counter is out of bounds, is so change states to get more data, if not, increment counter for next data slot in array
-{                                   // would be nice if C has operator overloading like C++  
-	if (counter < 64)
-	{
-		counter++;   
+	if ((p->seen & NIBP_PRESSURE_VALUES) != NIBP_PRESSURE_VALUES)
+		return;
+	if (p->seen == NIBP_ALL_VALUES) {
+		for (slot = 0; slot < NIBP_FRAME_VALUES; slot++)
+			me->measurement[slot].u = p->frame[slot];
+		me->measurementValues = NIBP_FRAME_VALUES;
+	} else {
+		for (slot = 0; slot < NIBP_PRESSURE_COUNT; slot++)
+			me->measurement[slot].u = p->frame[NIBP_SYSTOLE + slot];
+		me->measurementValues = NIBP_PRESSURE_COUNT;
 	}
-	else // change states, we need more data:: Issue, may cause lost of blood pressure data
-	{
-		UNEXPECTED_SIGNAL("test_MAIN_SENSOR.c:handleSampleFSM", "SAMPLE_ACK",event->signal);  
-		bspPrint("unexpected signal");
+	me->hasMeasurement = 1;
+}
+
+//a one-value record got its value
+static void recordValue(mainSensorActiveObjectPtr me, uint8_t value)
+{
+	if (me->parser.record == NIBP_PULSE) {
+		me->pulse.u = value;
+		me->hasPulse = 1;
 	}
-	return counter;
+	//information, quality and gain are ignored for now
+	me->parser.record = 0;
+}
 
+static void startFrame(NibpParser *p)
+{
+	p->state = NIBP_FIELD;
+	p->frameBytes = 0;
+	p->seen = 0;
 }
 
+//back to what the frame interrupted: a record waiting for its value, or nothing
+static void endFrame(NibpParser *p)
+{
+	p->state = p->record ? NIBP_VALUE : NIBP_IDLE;
+}
 
+//a field letter starts the field's values. anything else between fields (delimiters,
+//fields we do not know) is skipped
+static void startField(NibpParser *p, uint8_t letter)
+{
+	switch (letter) {
+	case 'S': p->slot = NIBP_STATUS; p->digits = 1; p->slotsLeft = 0; break;
+	case 'C': p->slot = NIBP_CYCLE; p->digits = 2; p->slotsLeft = 0; break;
+	case 'M': p->slot = NIBP_MESSAGE; p->digits = 2; p->slotsLeft = 0; break;
+	case 'P': p->slot = NIBP_SYSTOLE; p->digits = 3; p->slotsLeft = 2; break;
+	case 'R': p->slot = NIBP_HEART_RATE; p->digits = 3; p->slotsLeft = 0; break;
+	case 'T': p->slot = NIBP_NEXT_EVENT; p->digits = 4; p->slotsLeft = 0; break;
+	default: return;
+	}
+	p->state = NIBP_DIGITS;
+	p->digitsLeft = p->digits;
+	p->value = 0;
+}
 
+void nibpParserReset(NibpParser *p)
+{
+	memset(p, 0, sizeof (NibpParser));
+	p->state = NIBP_IDLE;
+}
 
+int nibpParse(mainSensorActiveObjectPtr me, const uint8_t *bytes, int length)
+{
+	NibpParser *p = &me->parser;
+	int i;
+
+	for (i = 0; i < length; i++) {
+		uint8_t byte = bytes[i];
+
+		if (byte == STX) {
+			//a frame also cuts off one in progress, which is dropped
+			startFrame(p);
+		} else if (p->state == NIBP_IDLE) {
+			if (byte == NIBP_PULSE || byte == NIBP_INFO || byte == NIBP_QUALITY || byte == NIBP_GAIN) {
+				p->record = byte;
+				p->state = NIBP_VALUE;
+			}
+			//anything else is junk, or the tail of a record we joined late
+		} else if (p->state == NIBP_VALUE) {
+			recordValue(me, byte);
+			p->state = NIBP_IDLE;
+		} else if (byte == ETX) {
+			//complete unless it cut off a value
+			if (p->state == NIBP_FIELD)
+				keepFrame(me);
+			endFrame(p);
+		} else if (++p->frameBytes > NIBP_MAX_FRAME_BYTES) {
+			endFrame(p);
+		} else if (p->state == NIBP_FIELD) {
+			startField(p, byte);
+		} else if (byte > 9) {
+			//not a digit, the frame is corrupt
+			endFrame(p);
+		} else {
+			p->value = 10 * p->value + byte;
+			if (--p->digitsLeft == 0) {
+				p->frame[p->slot] = p->value;
+				p->seen |= 1 << p->slot;
+				if (p->slotsLeft > 0) {
+					p->slotsLeft--;
+					p->slot++;
+					p->digitsLeft = p->digits;
+					p->value = 0;
+				} else {
+					p->state = NIBP_FIELD;
+				}
+			}
+		}
+	}
+	return p->state != NIBP_IDLE;
+}
 
 
 
@@ -29,7 +29,9 @@
 //info on what these fields do
 #define MAIN_SENSOR_NAME       					"mainSensor"
 #define MAIN_SENSOR_VERSION							"1.0"
-#define MAIN_SENSOR_HAS_INTERRUPTS						0
+#ifndef MAIN_SENSOR_HAS_INTERRUPTS
+#define MAIN_SENSOR_HAS_INTERRUPTS						0 //1 to receive through the UART interrupt and a ring
+#endif
 #define MAIN_SENSOR_MIN_VALUE                  CELSIUS2UKELVIN(-55)
 #define MAIN_SENSOR_MAX_VALUE                  CELSIUS2UKELVIN(125)
 #define MAIN_SENSOR_SUBID						SIR_DEFAULT_SENSOR_SUBID
@@ -93,6 +95,71 @@
 #define DELIM 0x3B//delimeter
 #define CR 0x0D //carriage Return
 
+//headers of the one-value records, besides STX for blood pressure frames
+#define NIBP_PULSE 0xFA
+#define NIBP_INFO 0xFB
+#define NIBP_QUALITY 0xFC
+#define NIBP_GAIN 0xF4
+
+#define MAIN_SENSOR_INFLATE_MS 15000 //the cuff inflates and measures for up to this long
+#if MAIN_SENSOR_HAS_INTERRUPTS
+#define MAIN_SENSOR_POLL_MS 5 //how often the ring is drained meanwhile
+#define UART_RING_BYTES 1024 //holds what the sensor sends between two polls
+#include "uart_ring.h"
+#else
+#define MAIN_SENSOR_POLL_MS 1000 //how often the sensor is read meanwhile
+#endif
+#define MAIN_SENSOR_READ_BYTES 64 //bytes returned by one SIP_SensorUartRead
+#define MAIN_SENSOR_MAX_READS 4 //reads per poll to finish a record cut off by the end of a read
+#define NIBP_MAX_FRAME_BYTES 64 //a blood pressure frame longer than this is noise, and dropped
+
+//values of a blood pressure frame, in the order they are sent to the analytics
+enum {
+	NIBP_STATUS,		// 'S', 1 digit
+	NIBP_CYCLE,			// 'C', 2 digits, minutes between measurements
+	NIBP_MESSAGE,		// 'M', 2 digits
+	NIBP_SYSTOLE,		// 'P', 3 digits each
+	NIBP_DIASTOLE,
+	NIBP_MEAN,
+	NIBP_HEART_RATE,	// 'R', 3 digits
+	NIBP_NEXT_EVENT,	// 'T', 4 digits, seconds to the next measurement
+	NIBP_FRAME_VALUES
+};
+
+//a frame without all three pressures is a status report from a cuff still measuring
+#define NIBP_PRESSURE_VALUES ((1 << NIBP_SYSTOLE) | (1 << NIBP_DIASTOLE) | (1 << NIBP_MEAN))
+
+#define NIBP_ALL_VALUES ((1 << NIBP_FRAME_VALUES) - 1)
+
+//a frame that carried every value goes to the analytics as a record of NIBP_FRAME_VALUES
+//in NIBP_* order. records have no mark for a missing value, so a frame that lacked any
+//of the others goes as a record of NIBP_PRESSURE_COUNT: systole, diastole and mean
+#define NIBP_PRESSURE_COUNT 3
+
+//parser states
+enum {
+	NIBP_IDLE,		//between records. 0, so the zeroed active object starts here
+	NIBP_VALUE,		//a one-value record waits for its value
+	NIBP_FIELD,		//in a blood pressure frame, between fields
+	NIBP_DIGITS		//in a blood pressure frame, reading a field's digits
+};
+
+//The parser takes the sensor's bytes one at a time and keeps where it is between
+//reads, so a record that is cut off by the end of one read is finished by the
+//next without the bytes being copied anywhere. Every byte costs constant time.
+typedef struct {
+	uint8_t state;
+	uint8_t record;			//header of the one-value record waiting for its value, 0 for none
+	uint8_t slot;			//NIBP_* value being read
+	uint8_t slotsLeft;		//values of the current field still to read, after this one
+	uint8_t digits;			//digits per value of the current field
+	uint8_t digitsLeft;
+	uint8_t frameBytes;
+	uint8_t seen;			//bit per NIBP_* value the frame has carried
+	uint32_t value;
+	uint32_t frame[NIBP_FRAME_VALUES];
+} NibpParser;
+
 //This defines a structure for storing configuration values (such as the ones listed above).
 //For most sensors (this one included), the standard SipSensorConfig (physical sensor config)
 //is sufficient. This structure will be pointed to the actual sensor configuration defined
@@ -113,13 +180,29 @@ typedef struct mainSensorActiveObject *mainSensorActiveObjectPtr;
 //Unused. The standard SensorStateHandler type in sensor.h is sufficient
 typedef void (*mainSensorStateHandler)(mainSensorActiveObjectPtr, EventConstPtr );
 
-//This processes the blood pressure data
-
-
 //see above testDS18B20ActiveObjectPtr
 typedef struct mainSensorActiveObject {
 	SensorActiveObject super;
+	NibpParser parser;		//kept across reads and samples
+	uint8_t reads;			//reads in this poll
+	uint16_t waited;		//ms this sample has waited for the cuff
+	//what the sample has read, submitted to the analytics once it stops reading
+	SensorData measurement[NIBP_FRAME_VALUES];	//latest complete blood pressure frame
+	uint8_t measurementValues;	//NIBP_FRAME_VALUES or NIBP_PRESSURE_COUNT of them
+	SensorData pulse;							//latest pulse rate
+	uint8_t hasMeasurement;
+	uint8_t hasPulse;
+#if MAIN_SENSOR_HAS_INTERRUPTS
+	UartRing ring;			//filled by the UART receive interrupt
+	uint32_t dropped;		//ring overflows already logged
+	uint32_t stale;			//bytes received between samples, and discarded
+#endif
 } mainSensorActiveObject, *mainSensorActiveObjectPtr;
 
+void nibpParserReset(NibpParser *parser);
+//feeds length bytes from the sensor to me's parser, which keeps the latest
+//measurement and pulse they complete in me. nonzero while a record is incomplete
+int nibpParse(mainSensorActiveObjectPtr me, const uint8_t *bytes, int length);
+
 
 #endif /* __MAIN_SENSOR_ */
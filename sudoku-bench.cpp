@@ -0,0 +1,259 @@
+// Sudoku solver benchmark
+//
+// sudoku-bench [--engine first|mrv|snap|dlx] [--repeat R] [--json results.json] [corpus ...]
+//
+// Each corpus has one 81-character puzzle per line. Without corpus arguments the
+// sets in bench/ are used (easy, hard, 17-clue and unsolvable), and without
+// --engine the most-constrained backtracker, undoing through its trail (mrv) and
+// branching on board snapshots (snap), and Dancing Links are measured.
+//
+// Every set is run twice per engine:
+//   cold - each puzzle gets a fresh Sudoku and the CPU caches are flushed first
+//   warm - one solver is reused, one untimed pass, then R timed passes
+// and reports puzzles/sec, search nodes/sec and p50/p99/p999 wall-clock latency of
+// load + solve per puzzle. --json writes the same numbers for regression tracking.
+// Solutions are checked outside the timed region. $SUDOKU_KERNELS=scalar|sse4.2|avx2
+// picks the vector kernels to measure.
+// Cold dlx runs share one DancingLinks matrix per thread, as the batch driver does:
+// only the first pays for building it, the others exclude the build and find the
+// matrix evicted from the caches.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Sudoku.h"
+#include "SudokuKernels.h"
+using namespace std;
+
+struct Engine
+{
+   const char *name;
+   Sudoku::Engine engine;
+   Sudoku::SearchMode mode;
+};
+
+static const Engine ENGINES[] = {
+   { "first", Sudoku::BACKTRACKING, Sudoku::FIRST_EMPTY },
+   { "mrv", Sudoku::BACKTRACKING, Sudoku::MOST_CONSTRAINED },
+   { "snap", Sudoku::BACKTRACKING, Sudoku::SNAPSHOT },
+   { "dlx", Sudoku::DANCING_LINKS, Sudoku::FIRST_EMPTY }
+};
+
+struct Result
+{
+   string engine, set, phase;
+   long puzzles, solved, nodes;
+   double seconds, p50, p99, p999, max;
+};
+
+// bigger than the last level cache of our batch hosts
+const size_t EVICT_BYTES = 64 << 20;
+static vector<char> evictBuffer(EVICT_BYTES);
+
+static void evictCaches()
+{
+   for (size_t n = 0; n < evictBuffer.size(); n += 64)
+      evictBuffer[n]++;
+}
+
+static bool readCorpus(const string &name, vector<string> &puzzles)
+{
+   ifstream in(name.c_str());
+   if (!in)
+      return false;
+   string line;
+   while (getline(in, line))
+   {
+      if (line.size() >= 81)
+         puzzles.push_back(line);
+   }
+   return true;
+}
+
+// p-th percentile of sorted latencies, nearest rank
+static double percentile(const vector<double> &sorted, double p)
+{
+   if (sorted.empty())
+      return 0;
+   size_t rank = (size_t)(p * sorted.size() + 0.999999);
+   if (rank < 1)
+      rank = 1;
+   if (rank > sorted.size())
+      rank = sorted.size();
+   return sorted[rank - 1];
+}
+
+// times load + solve of one puzzle, in seconds
+static double timeOne(Sudoku &puzzle, const string &line, long &solved, long &nodes)
+{
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   puzzle.loadFromLine(line.data(), line.size());
+   bool ok = puzzle.solve();
+   double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+   // a solution only counts if it checks out
+   solved += ok && puzzle.isSolved();
+   nodes += puzzle.nodeCount();
+   return seconds;
+}
+
+static Result summarize(const string &engine, const string &set, const string &phase,
+                        vector<double> &latency, long solved, long nodes)
+{
+   Result r;
+   r.engine = engine;
+   r.set = set;
+   r.phase = phase;
+   r.puzzles = latency.size();
+   r.solved = solved;
+   r.nodes = nodes;
+   r.seconds = 0;
+   for (size_t n = 0; n < latency.size(); n++)
+      r.seconds += latency[n];
+   sort(latency.begin(), latency.end());
+   r.p50 = percentile(latency, 0.50);
+   r.p99 = percentile(latency, 0.99);
+   r.p999 = percentile(latency, 0.999);
+   r.max = latency.empty() ? 0 : latency.back();
+   return r;
+}
+
+static void printResult(const Result &r)
+{
+   printf("%-6s %-12s %-5s %8ld %8ld %12.0f %14.0f %10.1f %10.1f %10.1f %10.1f\n",
+          r.engine.c_str(), r.set.c_str(), r.phase.c_str(), r.puzzles, r.solved,
+          r.seconds > 0 ? r.puzzles / r.seconds : 0, r.seconds > 0 ? r.nodes / r.seconds : 0,
+          r.p50 * 1e6, r.p99 * 1e6, r.p999 * 1e6, r.max * 1e6);
+}
+
+static void writeJson(const char *name, const vector<Result> &results, int repeat)
+{
+   FILE *out = fopen(name, "w");
+   if (out == NULL)
+   {
+      cerr << "Cannot open " << name << endl;
+      return;
+   }
+   fprintf(out, "{\n  \"repeat\": %d,\n  \"results\": [\n", repeat);
+   for (size_t n = 0; n < results.size(); n++)
+   {
+      const Result &r = results[n];
+      fprintf(out, "    {\"engine\": \"%s\", \"set\": \"%s\", \"phase\": \"%s\", "
+                   "\"puzzles\": %ld, \"solved\": %ld, \"nodes\": %ld, \"seconds\": %.9f, "
+                   "\"puzzles_per_sec\": %.1f, \"nodes_per_sec\": %.1f, "
+                   "\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f}%s\n",
+              r.engine.c_str(), r.set.c_str(), r.phase.c_str(), r.puzzles, r.solved, r.nodes,
+              r.seconds, r.seconds > 0 ? r.puzzles / r.seconds : 0,
+              r.seconds > 0 ? r.nodes / r.seconds : 0,
+              r.p50 * 1e6, r.p99 * 1e6, r.p999 * 1e6, r.max * 1e6,
+              n + 1 < results.size() ? "," : "");
+   }
+   fprintf(out, "  ]\n}\n");
+   fclose(out);
+}
+
+int main(int argc, char * argv[])
+{
+   vector<const Engine *> engines;
+   vector<string> sets;
+   const char *jsonName = NULL;
+   int repeat = 20;
+
+   for (int a = 1; a < argc; a++)
+   {
+      string arg = argv[a];
+      if (arg == "--engine" && a + 1 < argc)
+      {
+         string name = argv[++a];
+         const Engine *e = NULL;
+         for (size_t n = 0; n < sizeof(ENGINES) / sizeof(ENGINES[0]); n++)
+            if (name == ENGINES[n].name)
+               e = &ENGINES[n];
+         if (e == NULL)
+         {
+            cerr << "Unknown engine " << name << endl;
+            return 1;
+         }
+         engines.push_back(e);
+      }
+      else if (arg == "--repeat" && a + 1 < argc)
+         repeat = atoi(argv[++a]);
+      else if (arg == "--json" && a + 1 < argc)
+         jsonName = argv[++a];
+      else
+         sets.push_back(arg);
+   }
+   if (engines.empty())
+   {
+      engines.push_back(&ENGINES[1]);
+      engines.push_back(&ENGINES[2]);
+      engines.push_back(&ENGINES[3]);
+   }
+   if (sets.empty())
+   {
+      sets.push_back("bench/easy.txt");
+      sets.push_back("bench/hard.txt");
+      sets.push_back("bench/17clue.txt");
+      sets.push_back("bench/unsolvable.txt");
+   }
+   if (repeat < 1)
+      repeat = 1;
+
+   vector<Result> results;
+   printf("kernels: %s\n", sudokuKernels().name);
+   printf("%-6s %-12s %-5s %8s %8s %12s %14s %10s %10s %10s %10s\n", "engine", "set", "phase",
+          "puzzles", "solved", "puzzles/s", "nodes/s", "p50 us", "p99 us", "p999 us", "max us");
+
+   for (size_t s = 0; s < sets.size(); s++)
+   {
+      vector<string> puzzles;
+      if (!readCorpus(sets[s], puzzles))
+      {
+         cerr << "Cannot open " << sets[s] << endl;
+         return 1;
+      }
+      // report the set by its file name without directory and extension
+      string setName = sets[s].substr(sets[s].find_last_of('/') + 1);
+      setName = setName.substr(0, setName.find('.'));
+
+      for (size_t e = 0; e < engines.size(); e++)
+      {
+         vector<double> latency;
+         long solved = 0, nodes = 0;
+
+         for (size_t n = 0; n < puzzles.size(); n++)
+         {
+            evictCaches();
+            Sudoku puzzle;
+            puzzle.setEngine(engines[e]->engine);
+            puzzle.setSearchMode(engines[e]->mode);
+            latency.push_back(timeOne(puzzle, puzzles[n], solved, nodes));
+         }
+         results.push_back(summarize(engines[e]->name, setName, "cold", latency, solved, nodes));
+         printResult(results.back());
+
+         Sudoku puzzle;
+         puzzle.setEngine(engines[e]->engine);
+         puzzle.setSearchMode(engines[e]->mode);
+         long ignore = 0;
+         for (size_t n = 0; n < puzzles.size(); n++)
+            timeOne(puzzle, puzzles[n], ignore, ignore);
+
+         latency.clear();
+         solved = nodes = 0;
+         for (int r = 0; r < repeat; r++)
+            for (size_t n = 0; n < puzzles.size(); n++)
+               latency.push_back(timeOne(puzzle, puzzles[n], solved, nodes));
+         results.push_back(summarize(engines[e]->name, setName, "warm", latency, solved, nodes));
+         printResult(results.back());
+      }
+   }
+
+   if (jsonName != NULL)
+      writeJson(jsonName, results, repeat);
+   return 0;
+}
@@ -3,24 +3,481 @@
 // Project 1 - Sudoku Solver
 // Oct. 2006
 
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
 #include <iostream>
+#include <signal.h>
 #include <string>
 #include <time.h>
+#include <unistd.h>
+#include <vector>
 #include "Sudoku.h"
+#include "GridWriter.h"
+#include "LogicSolver.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include "PuzzleArchive.h"
+#include "PuzzleGenerator.h"
+#include "SolutionCache.h"
+#include "SolverServer.h"
 using namespace std;
 
+// Batch mode: sudoku-driver --batch corpus.txt [solutions.txt] [--cache entries]
+//             sudoku-driver --pack corpus.txt archive.sdk
+//             sudoku-driver --rate corpus.txt [ratings.txt]
+//             sudoku-driver --show archive.sdk n
+//             sudoku-driver --generate count [puzzles.txt] [--clues n]
+//                           [--difficulty easy|medium|hard] [--seed s]
+//             sudoku-driver --serve socket [--queue n] [--cache entries]
+// Interactive: sudoku-driver [--trace file | --logic]
+//
+// The corpus has one 81-character puzzle per line. The solutions are written one
+// per line, in input order, to the output file (or stdout); a line that cannot be
+// solved is written as "No Solution", one that is not a puzzle as "Bad Puzzle".
+// --pack writes the puzzles and their solutions to a binary PuzzleArchive instead,
+// record n for line n (an empty grid for a bad puzzle), and --show prints record n
+// of an archive. --rate writes the difficulty of each puzzle instead: the score
+// and name of the hardest technique LogicSolver needed, like "3.4 hidden pair",
+// or "10.0 search" if the techniques alone cannot solve it. With --cache, puzzles
+// equivalent to one already solved (see SolutionCache.h) are answered from an LRU
+// cache of that many entries.
+// --generate writes count new puzzles with unique solutions in the corpus format,
+// with at most n clues and in the given difficulty band if asked for. Chunk k of
+// the output always comes from seed s + k, so a run can be repeated exactly on
+// any number of threads.
+// --serve runs as a daemon answering puzzles sent to a Unix socket, see
+// SolverServer.h, until it gets SIGINT or SIGTERM.
+// The corpus is memory mapped and puzzles are parsed in place. They are taken in
+// blocks, each block is cut into chunks that the thread pool spreads over all
+// cores, and the block is written out before the next one is started. Output goes
+// through a GridWriter, one system call per megabyte.
+
+const int BATCH_BLOCK = 1 << 16;   // puzzles solved and written at a time
+const int BATCH_CHUNK = 512;       // puzzles per pool task
+const int LINE_SLOT = 82;          // 81 digits and a newline
+
+// the output file, truncated, or stdout for NULL. -1 if it cannot be opened
+static int openOutput(const char *outputName)
+{
+   if (outputName == NULL)
+      return STDOUT_FILENO;
+   return open(outputName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+// flushes the writer and closes fd unless it is stdout. false if a write failed
+static bool closeOutput(GridWriter &writer, int fd)
+{
+   bool written = writer.flush();
+   if (fd != STDOUT_FILENO)
+      written = close(fd) == 0 && written;
+   return written;
+}
+
+// what runBatch() writes for each puzzle
+enum BatchOutput
+{
+   SOLUTIONS,
+   ARCHIVE,
+   RATINGS
+};
+
+static int runBatch(const char *corpusName, const char *outputName, BatchOutput mode, SolutionCache *cache)
+{
+   MappedFile corpus(corpusName);
+   if (!corpus.isOpen())
+   {
+      cerr << "Cannot open " << corpusName << endl;
+      return 1;
+   }
+   int out = STDOUT_FILENO;
+   PuzzleArchiveWriter *archive = NULL;
+   if (mode == ARCHIVE)
+   {
+      archive = new PuzzleArchiveWriter(outputName, true);
+      if (!archive->isOpen())
+      {
+         cerr << "Cannot open " << outputName << endl;
+         delete archive;
+         return 1;
+      }
+   }
+   else if ((out = openOutput(outputName)) < 0)
+   {
+      cerr << "Cannot open " << outputName << endl;
+      return 1;
+   }
+   GridWriter writer(out);
+
+   ThreadPool pool;
+   // one solver per worker, reused for every puzzle that worker picks up
+   vector<Sudoku> solvers(pool.size());
+   for (size_t w = 0; w < solvers.size(); w++)
+      solvers[w].setEngine(Sudoku::DANCING_LINKS);
+   vector<LogicSolver> raters(mode == RATINGS ? pool.size() : 0);
+
+   vector<const char *> input(BATCH_BLOCK);
+   vector<int> inputLength(BATCH_BLOCK);
+   vector<char> output(BATCH_BLOCK * LINE_SLOT);
+   vector<int> outputLength(BATCH_BLOCK);
+   const char *next = corpus.data(), *end = corpus.data() + corpus.size();
+   long total = 0, unsolved = 0;
+   vector<long> unsolvedByWorker(pool.size());
+
+   chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+   for (;;)
+   {
+      int count = 0;
+      while (count < BATCH_BLOCK && next < end)
+      {
+         const char *line = next;
+         const char *newline = (const char *)memchr(line, '\n', end - line);
+         next = newline != NULL ? newline + 1 : end;
+         int length = (newline != NULL ? newline : end) - line;
+         if (length == 0 || (length == 1 && line[0] == '\r'))
+            continue;
+         input[count] = line;
+         inputLength[count] = length;
+         count++;
+      }
+      if (count == 0)
+         break;
+
+      for (int first = 0; first < count; first += BATCH_CHUNK)
+      {
+         int last = first + BATCH_CHUNK < count ? first + BATCH_CHUNK : count;
+         pool.submit([&, first, last](int worker)
+         {
+            Sudoku &puzzle = solvers[worker];
+            for (int n = first; n < last; n++)
+            {
+               char *slot = &output[n * LINE_SLOT];
+               if (!puzzle.loadFromLine(input[n], inputLength[n]))
+               {
+                  outputLength[n] = sprintf(slot, "Bad Puzzle\n");
+                  unsolvedByWorker[worker]++;
+               }
+               else if (mode == RATINGS)
+               {
+                  LogicSolver::Rating rating = raters[worker].rate(puzzle);
+                  if (rating.contradiction)
+                  {
+                     outputLength[n] = sprintf(slot, "No Solution\n");
+                     unsolvedByWorker[worker]++;
+                  }
+                  else
+                     outputLength[n] = sprintf(slot, "%d.%d %s\n", rating.score / 10, rating.score % 10,
+                                               LogicSolver::name(rating.hardest));
+               }
+               else if (!(cache != NULL ? cache->solve(puzzle) : puzzle.solve()))
+               {
+                  outputLength[n] = sprintf(slot, "No Solution\n");
+                  unsolvedByWorker[worker]++;
+               }
+               else
+                  outputLength[n] = puzzle.format(slot, Sudoku::LINE);
+            }
+         });
+      }
+      pool.wait();
+
+      if (archive != NULL)
+      {
+         Sudoku givens, solution;
+         for (int n = 0; n < count; n++)
+         {
+            givens.loadFromLine(input[n], inputLength[n]);
+            bool solved = outputLength[n] == LINE_SLOT;
+            if (solved)
+               solution.loadFromLine(&output[n * LINE_SLOT], 81);
+            archive->add(givens, solved ? &solution : NULL);
+         }
+      }
+      else
+      {
+         for (int n = 0; n < count; n++)
+            writer.write(&output[n * LINE_SLOT], outputLength[n]);
+      }
+      total += count;
+   }
+
+   double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+   for (size_t w = 0; w < unsolvedByWorker.size(); w++)
+      unsolved += unsolvedByWorker[w];
+   if (archive != NULL)
+   {
+      bool written = archive->close();
+      delete archive;
+      if (!written)
+      {
+         cerr << "Error writing " << outputName << endl;
+         return 1;
+      }
+   }
+   else if (!closeOutput(writer, out))
+   {
+      cerr << "Error writing " << (outputName != NULL ? outputName : "output") << endl;
+      return 1;
+   }
+
+   cerr << total << " puzzles (" << unsolved << " unsolved) in " << seconds << " seconds, "
+        << (seconds > 0 ? total / seconds : 0) << " puzzles/sec on " << pool.size() << " threads" << endl;
+   if (cache != NULL)
+      cerr << cache->hits() << " cache hits, " << cache->misses() << " misses" << endl;
+   return 0;
+}
+
+const int GENERATE_CHUNK = 64;     // puzzles per pool task when generating
+
+static int runGenerate(long count, const char *outputName, int clues, PuzzleGenerator::Difficulty difficulty,
+                       unsigned long long seed)
+{
+   int out = openOutput(outputName);
+   if (out < 0)
+   {
+      cerr << "Cannot open " << outputName << endl;
+      return 1;
+   }
+   GridWriter writer(out);
+
+   ThreadPool pool;
+   // one generator per worker, reseeded for every chunk it picks up
+   vector<PuzzleGenerator> generators(pool.size());
+   for (size_t w = 0; w < generators.size(); w++)
+   {
+      generators[w].setTargetClues(clues);
+      generators[w].setDifficulty(difficulty);
+   }
+
+   vector<char> output(BATCH_BLOCK * LINE_SLOT);
+   vector<int> outputLength(BATCH_BLOCK);
+   long written = 0, failed = 0;
+   vector<long> failedByWorker(pool.size());
+
+   chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+   for (long done = 0; done < count; done += BATCH_BLOCK)
+   {
+      int block = count - done < BATCH_BLOCK ? count - done : BATCH_BLOCK;
+      for (int first = 0; first < block; first += GENERATE_CHUNK)
+      {
+         int last = first + GENERATE_CHUNK < block ? first + GENERATE_CHUNK : block;
+         unsigned long long chunkSeed = seed + (done + first) / GENERATE_CHUNK;
+         pool.submit([&, first, last, chunkSeed](int worker)
+         {
+            PuzzleGenerator &generator = generators[worker];
+            generator.seed(chunkSeed);
+            for (int n = first; n < last; n++)
+            {
+               char *slot = &output[n * LINE_SLOT];
+               if (generator.generate(slot))
+               {
+                  slot[81] = '\n';
+                  outputLength[n] = LINE_SLOT;
+               }
+               else
+               {
+                  outputLength[n] = 0;
+                  failedByWorker[worker]++;
+               }
+            }
+         });
+      }
+      pool.wait();
+
+      for (int n = 0; n < block; n++)
+      {
+         writer.write(&output[n * LINE_SLOT], outputLength[n]);
+         written += outputLength[n] != 0;
+      }
+   }
+
+   double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+   for (size_t w = 0; w < failedByWorker.size(); w++)
+      failed += failedByWorker[w];
+   if (!closeOutput(writer, out))
+   {
+      cerr << "Error writing " << (outputName != NULL ? outputName : "output") << endl;
+      return 1;
+   }
+
+   cerr << written << " puzzles in " << seconds << " seconds, " << (seconds > 0 ? written / seconds : 0)
+        << " puzzles/sec on " << pool.size() << " threads";
+   if (failed > 0)
+      cerr << ", " << failed << " gave up on the target";
+   cerr << endl;
+   return 0;
+}
+
+static int showArchived(const char *archiveName, const char *number)
+{
+   PuzzleArchive archive(archiveName);
+   if (!archive.isOpen())
+   {
+      cerr << "Cannot read archive " << archiveName << endl;
+      return 1;
+   }
+   unsigned long n = strtoul(number, NULL, 10);
+   Sudoku puzzle, solution;
+   if (!archive.load(n, puzzle, archive.hasSolutions() ? &solution : NULL))
+   {
+      cerr << "No puzzle " << n << " in " << archiveName << " (" << archive.size() << " puzzles)" << endl;
+      return 1;
+   }
+   if (!archive.verifyBlock((uint32_t)(n / archive.recordsPerBlock())))
+      cerr << "Warning: checksum mismatch in the block holding puzzle " << n << endl;
+
+   cout << "Puzzle " << n << ":" << endl << endl;
+   puzzle.print();
+   if (archive.hasSolutions())
+   {
+      cout << endl << "Solution:" << endl << endl;
+      solution.print();
+   }
+   return 0;
+}
+
+static SolverServer *serving = NULL;
+
+static void stopServing(int)
+{
+   if (serving != NULL)
+      serving->stop();
+}
+
+static int runServer(const char *socketPath, int queueLimit, SolutionCache *cache)
+{
+   SolverServer server(socketPath, queueLimit, cache);
+   if (!server.start())
+   {
+      cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+      return 1;
+   }
+   serving = &server;
+   signal(SIGINT, stopServing);
+   signal(SIGTERM, stopServing);
+   cerr << "Serving on " << socketPath << " with " << server.workers() << " workers" << endl;
+   server.run();
+   serving = NULL;
+   if (cache != NULL)
+      cerr << cache->hits() << " cache hits, " << cache->misses() << " misses" << endl;
+   return 0;
+}
+
 int main(int argc, char * argv[])
 {
    string ans, filename;
    Sudoku puzzle;
 
+   if (argc >= 3 && (string(argv[1]) == "--batch" || string(argv[1]) == "--pack" || string(argv[1]) == "--rate"))
+   {
+      // --cache entries may follow the file names
+      SolutionCache *cache = NULL;
+      if (argc >= 5 && string(argv[argc - 2]) == "--cache")
+      {
+         cache = new SolutionCache(strtoul(argv[argc - 1], NULL, 10));
+         argc -= 2;
+      }
+      int status = 1;
+      if (string(argv[1]) == "--batch")
+         status = runBatch(argv[2], argc >= 4 ? argv[3] : NULL, SOLUTIONS, cache);
+      else if (string(argv[1]) == "--rate")
+         status = runBatch(argv[2], argc >= 4 ? argv[3] : NULL, RATINGS, NULL);
+      else if (argc >= 4)
+         status = runBatch(argv[2], argv[3], ARCHIVE, cache);
+      delete cache;
+      return status;
+   }
+   if (argc >= 4 && string(argv[1]) == "--show")
+      return showArchived(argv[2], argv[3]);
+   if (argc >= 3 && string(argv[1]) == "--serve")
+   {
+      int queueLimit = 4096;
+      SolutionCache *cache = NULL;
+      for (int a = 3; a + 1 < argc; a += 2)
+      {
+         if (string(argv[a]) == "--queue")
+            queueLimit = atoi(argv[a + 1]);
+         else if (string(argv[a]) == "--cache" && cache == NULL)
+            cache = new SolutionCache(strtoul(argv[a + 1], NULL, 10));
+      }
+      int status = runServer(argv[2], queueLimit, cache);
+      delete cache;
+      return status;
+   }
+   if (argc >= 3 && string(argv[1]) == "--generate")
+   {
+      const char *outputName = NULL;
+      int clues = 0;
+      PuzzleGenerator::Difficulty difficulty = PuzzleGenerator::ANY;
+      unsigned long long seed = time(NULL);
+      for (int a = 3; a < argc; a++)
+      {
+         string arg = argv[a];
+         if (arg == "--clues" && a + 1 < argc)
+            clues = atoi(argv[++a]);
+         else if (arg == "--seed" && a + 1 < argc)
+            seed = strtoull(argv[++a], NULL, 10);
+         else if (arg == "--difficulty" && a + 1 < argc)
+         {
+            string band = argv[++a];
+            if (band == "easy")
+               difficulty = PuzzleGenerator::EASY;
+            else if (band == "medium")
+               difficulty = PuzzleGenerator::MEDIUM;
+            else if (band == "hard")
+               difficulty = PuzzleGenerator::HARD;
+            else
+            {
+               cerr << "Unknown difficulty " << band << endl;
+               return 1;
+            }
+         }
+         else
+            outputName = argv[a];
+      }
+      return runGenerate(atol(argv[2]), outputName, clues, difficulty, seed);
+   }
+
+   // --trace file records the branching of every solve, needs a SUDOKU_STATS build
+   SudokuTrace *trace = NULL;
+   if (argc >= 3 && string(argv[1]) == "--trace")
+   {
+#ifndef SUDOKU_STATS
+      cerr << "--trace needs a SUDOKU_STATS build" << endl;
+      return 1;
+#endif
+      trace = new SudokuTrace(argv[2], Sudoku::SIZE);
+      if (!trace->isOpen())
+      {
+         cerr << "Cannot open " << argv[2] << endl;
+         return 1;
+      }
+      puzzle.setTrace(trace);
+   }
+   // --logic solves each puzzle with LogicSolver's techniques first, the search only
+   // finishes what they leave, and prints the difficulty rating they give it
+   bool logic = argc >= 2 && string(argv[1]) == "--logic";
+   LogicSolver logicSolver;
+   LogicSolver::Rating rating;
+
    cout << "\nSudoku Solver" << endl;
    cout << "-------------" << endl << endl;
 
    do {
       cout << "\nEnter name of file containing the Sudoku problem: ";
-      cin >> filename;
-      puzzle.loadFromFile(filename);
+      if (!(cin >> filename))
+         break;
+      if (!puzzle.loadFromFile(filename))
+      {
+         cout << "Could not read a puzzle from " << filename << endl;
+         ans = "Y";   // ask for another file
+         continue;
+      }
 
       cout << "Given Puzzle:" << endl << endl;
       puzzle.print();
@@ -29,7 +486,7 @@ int main(int argc, char * argv[])
 
       clock_t startTime = clock(); 
 
-      if (puzzle.solve())
+      if (logic ? logicSolver.solve(puzzle, &rating) : puzzle.solve())
          puzzle.print(); // print solved puzzle
       else
          cout << endl << "No Solution" << endl; // indicate there is no solution
@@ -37,6 +494,16 @@ int main(int argc, char * argv[])
       clock_t endTime = clock(); 
 
       cout << "\n\nTime used: " << (endTime - startTime)/(double)CLOCKS_PER_SEC << " seconds.\n" << endl;
+      if (logic)
+         cout << "Difficulty: " << rating.score / 10 << "." << rating.score % 10 << " "
+              << LogicSolver::name(rating.hardest) << ", " << rating.steps << " steps" << endl;
+
+#ifdef SUDOKU_STATS
+      const SudokuStats &stats = puzzle.statistics();
+      cout << "Nodes: " << stats.nodes << "  Backtracks: " << stats.backtracks
+           << "  Max depth: " << stats.maxDepth << "  Propagated: " << stats.propagations << endl;
+      cout << "Propagation: " << stats.propagateSeconds << " s of " << stats.totalSeconds << " s\n" << endl;
+#endif
 
       //// Note: if you have the answer to your puzzle in another file, you can use
       //// the following code to compare your solution to the known answer.
@@ -54,6 +521,8 @@ int main(int argc, char * argv[])
 
    } while (ans == "Y" || ans == "y");
 
+   delete trace;
+
 
    return 0;
 }
@@ -0,0 +1,109 @@
+/**
+ * @file   uart_ring.h
+ * @brief  Lock-free single-producer/single-consumer byte ring between a UART
+ *         receive interrupt and the active object that parses its bytes
+ *
+ * The interrupt is the only writer of head, the active object the only writer
+ * of tail, so neither ever waits for the other: a full ring drops the byte and
+ * counts it. The consumer reads the queued bytes in place, as at most two
+ * contiguous spans (up to the end of the storage, then from its start), and
+ * releases them once parsed. The indices run freely and are masked on use, so
+ * UART_RING_BYTES must be a power of two.
+ */
+
+#ifndef __UART_RING_
+#define __UART_RING_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifndef UART_RING_BYTES
+#define UART_RING_BYTES 1024
+#endif
+
+#if (UART_RING_BYTES & (UART_RING_BYTES - 1)) != 0
+#error "UART_RING_BYTES must be a power of two"
+#endif
+
+typedef struct {
+	_Atomic uint32_t head;		//next byte the interrupt writes
+	_Atomic uint32_t tail;		//next byte the active object reads
+	_Atomic uint32_t dropped;	//bytes that found the ring full
+	uint8_t data[UART_RING_BYTES];
+} UartRing;
+
+static inline void uartRingInit(UartRing *ring)
+{
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->dropped, 0);
+}
+
+//producer side, interrupt context
+static inline void uartRingPush(UartRing *ring, uint8_t byte)
+{
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == UART_RING_BYTES) {
+		//only the interrupt writes it, so a load and a store will do. an atomic
+		//add would need libatomic on cores without one, like the Cortex-M0
+		atomic_store_explicit(&ring->dropped,
+			atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+		return;
+	}
+	ring->data[head & (UART_RING_BYTES - 1)] = byte;
+	//publishes the byte before the index that makes it visible
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+//producer side. nonzero if the next byte would be dropped
+static inline int uartRingFull(UartRing *ring)
+{
+	return atomic_load_explicit(&ring->head, memory_order_relaxed) -
+		atomic_load_explicit(&ring->tail, memory_order_acquire) == UART_RING_BYTES;
+}
+
+//consumer side. the queued bytes from tail up to the end of the storage, or NULL
+//if there are none. they stay valid until uartRingConsume releases them
+static inline const uint8_t *uartRingPeek(UartRing *ring, uint32_t *length)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uint32_t queued = atomic_load_explicit(&ring->head, memory_order_acquire) - tail;
+	uint32_t offset = tail & (UART_RING_BYTES - 1);
+
+	if (queued == 0)
+		return NULL;
+	*length = queued < UART_RING_BYTES - offset ? queued : UART_RING_BYTES - offset;
+	return &ring->data[offset];
+}
+
+static inline void uartRingConsume(UartRing *ring, uint32_t length)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	//the bytes are read before the interrupt may overwrite them
+	atomic_store_explicit(&ring->tail, tail + length, memory_order_release);
+}
+
+//consumer side. releases everything queued unread, and returns how many bytes
+static inline uint32_t uartRingDiscard(UartRing *ring)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	atomic_store_explicit(&ring->tail, head, memory_order_release);
+	return head - tail;
+}
+
+static inline int uartRingEmpty(UartRing *ring)
+{
+	return atomic_load_explicit(&ring->head, memory_order_acquire) ==
+		atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
+
+static inline uint32_t uartRingDropped(UartRing *ring)
+{
+	return atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
+
+#endif /* __UART_RING_ */